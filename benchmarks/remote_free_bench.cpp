@@ -0,0 +1,79 @@
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "../malloc_3.cpp"
+
+// Producer threads allocate blocks and hand them to consumer threads through a
+// ring, the consumers free them. Every block is freed by a thread that doesn't
+// own its arena. Prints the total throughput for 1..N producer-consumer pairs.
+// usage: ./remote_free_bench [max_pairs] [blocks_per_pair]
+
+const int ring_size = 1024;
+
+struct Ring
+{
+    std::atomic<void *> slots[ring_size];
+    Ring()
+    {
+        for (int i = 0; i < ring_size; i++)
+        {
+            slots[i] = nullptr;
+        }
+    }
+};
+
+void producer(Ring *ring, long blocks)
+{
+    for (long i = 0; i < blocks; i++)
+    {
+        void *block = smalloc(16 + (i * 37) % 512);
+        std::atomic<void *> &slot = ring->slots[i % ring_size];
+        while (slot.load(std::memory_order_acquire))
+            std::this_thread::yield();
+        slot.store(block, std::memory_order_release);
+    }
+}
+
+void consumer(Ring *ring, long blocks)
+{
+    for (long i = 0; i < blocks; i++)
+    {
+        std::atomic<void *> &slot = ring->slots[i % ring_size];
+        void *block;
+        while (!(block = slot.load(std::memory_order_acquire)))
+            std::this_thread::yield();
+        slot.store(nullptr, std::memory_order_release);
+        sfree(block);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    int max_pairs = argc > 1 ? atoi(argv[1]) : std::thread::hardware_concurrency() / 2;
+    long blocks = argc > 2 ? atol(argv[2]) : 1000000;
+    if (max_pairs < 1)
+        max_pairs = 1;
+
+    std::cout << (USE_REMOTE_FREE ? "remote free" : "locked") << ", " << blocks << " blocks per pair" << std::endl;
+    for (int pairs = 1; pairs <= max_pairs; pairs++)
+    {
+        std::vector<Ring> rings(pairs);
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::thread> workers;
+        for (int p = 0; p < pairs; p++)
+        {
+            workers.emplace_back(producer, &rings[p], blocks);
+            workers.emplace_back(consumer, &rings[p], blocks);
+        }
+        for (auto &w : workers)
+        {
+            w.join();
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        std::cout << pairs << " pairs: " << elapsed.count() << " s, "
+                  << (long)(pairs * blocks / elapsed.count()) << " blocks/s" << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,54 @@
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "../malloc_3.cpp"
+
+// Every thread repeatedly frees and reallocates small blocks from a private
+// window of live pointers. Prints the total throughput for 1..N threads.
+// usage: ./tcache_bench [max_threads] [ops_per_thread]
+
+void worker(long ops, int seed)
+{
+    const int window = 32;
+    void *live[window] = {nullptr};
+    unsigned int state = seed;
+    for (long i = 0; i < ops; i++)
+    {
+        state = state * 1103515245 + 12345;
+        int slot = (state >> 16) % window;
+        sfree(live[slot]);
+        live[slot] = smalloc(16 + (state >> 8) % 512);
+    }
+    for (int slot = 0; slot < window; slot++)
+    {
+        sfree(live[slot]);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    int max_threads = argc > 1 ? atoi(argv[1]) : std::thread::hardware_concurrency();
+    long ops = argc > 2 ? atol(argv[2]) : 1000000;
+    if (max_threads < 1)
+        max_threads = 1;
+
+    std::cout << (USE_TCACHE ? "tcache" : "locked") << ", " << ops << " ops per thread" << std::endl;
+    for (int threads = 1; threads <= max_threads; threads++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; t++)
+        {
+            workers.emplace_back(worker, ops, t + 1);
+        }
+        for (auto &w : workers)
+        {
+            w.join();
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        std::cout << threads << " threads: " << elapsed.count() << " s, "
+                  << (long)(threads * ops / elapsed.count()) << " ops/s" << std::endl;
+    }
+    return 0;
+}
@@ -2,11 +2,103 @@
 #include <unistd.h>
 #include <cmath>
 #include <cstring>
+#include <cstdint>
+#include <algorithm>
 #include <sys/mman.h>
+#include <pthread.h>
+#include <atomic>
+#include <cassert>
+#include <cerrno>
+#include <new>
+#include <csignal>
+#include <ctime>
+#include <cstdio>
 #define SPLIT_SIZE 128
 #define LARGE_MEM 128 * 1024
+#ifndef USE_SLABS
+#define USE_SLABS 0
+#endif
+#define SLAB_SIZE 4096
+#define SLAB_CLASSES (SPLIT_SIZE / 8)
+#define SLAB_REGION_SIZE (256 * 1024 * 1024)
+#ifndef USE_TCACHE
+#define USE_TCACHE 0
+#endif
+#define TCACHE_MAX_SIZE 1024
+#define TCACHE_CLASSES (TCACHE_MAX_SIZE / 8)
+#define TCACHE_COUNT 7
+#ifndef ARENAS
+#define ARENAS 0 // 0 means one per CPU
+#endif
+#define MAX_ARENAS 64
+#ifndef USE_SEGMENTS
+#define USE_SEGMENTS 0 // arena 0 grows in mmap segments too, instead of with sbrk
+#endif
+#ifndef ARENA_SEGMENT_SIZE
+#define ARENA_SEGMENT_SIZE (64 * 1024 * 1024)
+#endif
+#ifndef USE_REMOTE_FREE
+#define USE_REMOTE_FREE 0
+#endif
+#ifndef USE_FASTBINS
+#define USE_FASTBINS 0
+#endif
+#define FASTBIN_MAX_SIZE 512 // whole block, metaData included
+#define FASTBIN_CLASSES (FASTBIN_MAX_SIZE / 8)
+#define FASTBIN_BUDGET (64 * 1024) // bytes held in fast bins before they are consolidated
+#ifndef COMPACT_HEADER
+#define COMPACT_HEADER 0
+#endif
+#ifndef OVERRIDE_NEW
+#define OVERRIDE_NEW 0 // route the global operator new/delete to smalloc/sfree
+#endif
+#ifndef USE_HUGE_PAGES
+#define USE_HUGE_PAGES 0
+#endif
+#define HUGE_PAGE_SIZE (2 * 1024 * 1024)
+#ifndef DYNAMIC_MMAP_THRESHOLD
+#define DYNAMIC_MMAP_THRESHOLD 0 // raise the mmap threshold to the size of freed mmapped blocks, like glibc
+#endif
+#define DEFAULT_MMAP_THRESHOLD_MAX (4 * 1024 * 1024 * sizeof(long))
+#ifndef TRIM_THRESHOLD
+#define TRIM_THRESHOLD 0 // give back a free wilderness larger than this. 0 never trims on sfree
+#endif
+#ifndef HEAP_GROWTH_GRANULE
+#define HEAP_GROWTH_GRANULE 0 // the heap grows so its top is a multiple of this power of 2. 0 grows by what is missing
+#endif
+#ifndef USE_PURGE
+#define USE_PURGE 0 // give the whole pages inside large free blocks back to the OS with madvise
+#endif
+#define PURGE_MIN_SIZE (64 * 1024) // smallest free block that is purged, metaData included
+#ifndef PURGE_DECAY_MS
+#define PURGE_DECAY_MS 0 // with USE_PURGE: free pages decay in the background over this time. 0 purges in sfree
+#endif
+#define PURGE_DECAY_STEPS 20 // the decay thread wakes this many times per decay time
+#ifndef MADV_FREE
+#define MADV_FREE MADV_DONTNEED // older headers
+#endif
+#ifndef USE_MMAP_CACHE
+#define USE_MMAP_CACHE 0 // keep the mappings of freed mmapped blocks for reuse
+#endif
+#define MMAP_CACHE_BUDGET (32 * 1024 * 1024) // bytes the cache may hold
+#define MMAP_CACHE_MAX_AGE_MS 1000           // a region not reused for this long is unmapped
+#define STATS_CLASSES 64 // size class i holds the blocks of [2^i, 2^(i+1)) bytes, metaData included
+#define SMALLOC_HUGE_PAGE_THRESHOLD (1000 * 1000 * 4)
+#define SCALLOC_HUGE_PAGE_THRESHOLD (1000 * 1000 * 2) // also for srealloc of mmapped blocks
+#define PAGE_SHIFT 12
+#define PAGEMAP_BITS 12 // three levels of 12 bits cover a 48 bit address space
+#define PAGEMAP_LEN (1 << PAGEMAP_BITS)
 #define DOUBLE 0
 #define ADDRESS 1
+#define FL_COUNT 64
+#define SL_LOG2 3
+#define SL_COUNT (1 << SL_LOG2)
+#define BEST_FIT 0
+#define TLSF 1
+#define BEST_FIT_TREE 2
+#ifndef FREE_LIST_POLICY
+#define FREE_LIST_POLICY BEST_FIT
+#endif
 
 #define PAYLOAD(x) ((uint8_t *)x + offset)
 
@@ -16,13 +108,54 @@ struct MallocTip
     MallocMetadata *front;
     // MallocTip(MallocMetadata *front) : front(front){};
 };
+// what the whole pages inside a free block went through (USE_PURGE)
+enum PageState
+{
+    PAGES_DIRTY,    // written to. small blocks stay this way
+    PAGES_DECAYING, // written to, and waiting in the dirty decay list
+    PAGES_MUZZY,    // MADV_FREE: the kernel may take them. waiting in the muzzy decay list
+    PAGES_CLEAN     // MADV_DONTNEED: they read as zero
+};
+#if COMPACT_HEADER
+/**
+ * Compact layout (dlmalloc style): the metaData is the first word only, with
+ * the flags and the arena packed next to the size. next/prev lie in the payload
+ * and are only valid while the block is free, and only free blocks have a tip,
+ * which is found through the prev_free bit of the block after them.
+ */
+struct MallocMetadata
+{
+    size_t size : 54;
+    size_t arena : 6; // index of the owning arena in arenas
+    size_t is_free : 1;
+    size_t prev_free : 1; // the block right below this one is free, so it has a tip
+    size_t pages : 2;     // PageState, only meaningful while the block is free
+    MallocMetadata *next;
+    MallocMetadata *prev;
+    // next/prev are zeroed since assigning a header also writes them to the payload
+    MallocMetadata(size_t _size = 0, uint16_t _arena = 0)
+        : size(_size), arena(_arena), is_free(true), prev_free(false), pages(PAGES_DIRTY), next(nullptr),
+          prev(nullptr){};
+    MallocTip *setTip()
+    {
+        MallocTip *tip = (MallocTip *)((uint8_t *)this + this->size - sizeof(MallocTip));
+        if (is_free) // the tip of a used block would be in its payload
+            tip->front = this;
+        return tip;
+    }
+};
+#else
 struct MallocMetadata
 {
     size_t size;
     bool is_free;
+    bool prev_free; // the block right below this one is free
+    uint8_t pages;  // PageState, only meaningful while the block is free
+    uint16_t arena; // index of the owning arena in arenas
     MallocMetadata *next;
     MallocMetadata *prev;
-    MallocMetadata(size_t _size = 0) : size(_size), is_free(true){};
+    MallocMetadata(size_t _size = 0, uint16_t _arena = 0)
+        : size(_size), is_free(true), prev_free(false), pages(PAGES_DIRTY), arena(_arena){};
     MallocTip *setTip()
     {
         MallocTip *tip = (MallocTip *)((uint8_t *)this + this->size - sizeof(MallocTip));
@@ -31,6 +164,7 @@ struct MallocMetadata
         return tip;
     }
 };
+#endif
 class CompareBy
 {
     int sort_type;
@@ -191,451 +325,2557 @@ int MetaDataList::getSize()
     return this->size;
 }
 
-const long max_size = (1e8);
+/**
+ * Segregated free list: free blocks are spread over FL_COUNT x SL_COUNT bins.
+ * The first level is the power of two of the size, the second level splits
+ * every power of two to SL_COUNT equal sub-ranges. Two bitmaps tell which bins
+ * are not empty, so the next non-empty bin is found with a couple of bit scans.
+ *
+ * BEST_FIT: every bin is kept sorted by (size, address), so bestFit returns
+ * exactly what a walk over a single sorted list would. A block that goes to
+ * either end of its bin (a run of equal-size blocks freed in address order, or
+ * in reverse) is linked in O(1) through the bin's head or tail, any other one
+ * walks the bin. That walk is the price of the exact placement, the tree
+ * (BEST_FIT_TREE) keeps it in O(log n).
+ * TLSF: bins are LIFO and the request is rounded up to the next bin, so the
+ * head of the first non-empty bin always fits. push, erase and bestFit are
+ * then O(1) no matter how many blocks are free (good fit, not best fit).
+ */
+class SegregatedList
+{
+private:
+    int size;
+    int policy;
+    CompareBy cmp;
+    MallocMetadata *heads[FL_COUNT][SL_COUNT];
+    MallocMetadata *tails[FL_COUNT][SL_COUNT];
+    uint64_t fl_bitmap;
+    uint32_t sl_bitmap[FL_COUNT];
+    static void mapping(size_t block_size, int *fl, int *sl);
+    MallocMetadata *findBin(int fl, int sl);
 
-const size_t meta_size = sizeof(MallocMetadata) + sizeof(MallocTip);
-const size_t offset = sizeof(MallocMetadata);
-MetaDataList free_list = MetaDataList(DOUBLE);
-MetaDataList mmap_list = MetaDataList(DOUBLE);
-MallocMetadata *wilderness; // may be free and may not. Thus - not in free_list!
-size_t free_blocks = 0;
-size_t free_bytes = 0;
-size_t allocated_blocks = 0; // total num of blocks
-size_t allocated_bytes = 0;
-size_t meta_data_bytes = 0;
-void *base_addr;
-bool initialized = false;
-
-void initialize()
+public:
+    SegregatedList(int policy = FREE_LIST_POLICY);
+    ~SegregatedList() = default;
+    void erase(MallocMetadata *to_delete);
+    void push(MallocMetadata *to_add);
+    MallocMetadata *bestFit(size_t needed_size);
+    int getSize();
+};
+SegregatedList::SegregatedList(int policy)
+    : size(0), policy(policy), cmp(DOUBLE), heads(), tails(), fl_bitmap(0), sl_bitmap()
 {
-    if (initialized)
-        return;
-    void *base_addr;
-    base_addr = sbrk(0);
-    long address = (long)base_addr;
-    if (address % 8 != 0)
+    if (policy != BEST_FIT && policy != TLSF)
     {
-        int add = 8 - address % 8;
-        sbrk(add);
+        std::cout << "WRONG free list policy" << std::endl;
     }
-    wilderness = nullptr;
-    initialized = true;
 }
-
-void updateMmapAdd(MallocMetadata *mmap_block)
+/**
+ * @brief calculates the bin of a block
+ *
+ * @param block_size size of the block (including metaData)
+ * @param fl first level index- the highest set bit of block_size
+ * @param sl second level index- the SL_LOG2 bits right below it
+ */
+void SegregatedList::mapping(size_t block_size, int *fl, int *sl)
 {
-    allocated_blocks++;
-    allocated_bytes += mmap_block->size - meta_size;
-    // meta_data_bytes += sizeof(MallocMetadata);
+    *fl = 63 - __builtin_clzl(block_size);
+    if (*fl < SL_LOG2)
+    {
+        *sl = 0;
+        return;
+    }
+    *sl = (block_size >> (*fl - SL_LOG2)) & (SL_COUNT - 1);
 }
-
-void updateMmapRemove(MallocMetadata *mmap_block)
+/**
+ * @brief finds the first non-empty bin from (fl, sl) and up
+ *
+ * @param sl may be SL_COUNT, meaning start from the next first level
+ * @return MallocMetadata* head of that bin. nullptr if there is none
+ */
+MallocMetadata *SegregatedList::findBin(int fl, int sl)
 {
-    allocated_blocks--;
-    allocated_bytes -= mmap_block->size - meta_size;
-    // meta_data_bytes -= sizeof(MallocMetadata);
+    uint32_t sl_map = (sl < SL_COUNT) ? sl_bitmap[fl] & (~0U << sl) : 0;
+    if (!sl_map)
+    {
+        uint64_t fl_map = (fl + 1 < FL_COUNT) ? fl_bitmap & (~0ULL << (fl + 1)) : 0;
+        if (!fl_map)
+            return nullptr;
+        fl = __builtin_ctzll(fl_map);
+        sl_map = sl_bitmap[fl];
+    }
+    sl = __builtin_ctz(sl_map);
+    return heads[fl][sl];
 }
-
-void eraseFreeBlock(MallocMetadata *block)
+void SegregatedList::push(MallocMetadata *to_add)
 {
-    if (block != wilderness)
+    int fl, sl;
+    mapping(to_add->size, &fl, &sl);
+    this->size++;
+    MallocMetadata *curr = heads[fl][sl];
+    // Bin is empty or new node should be its head (always, for TLSF)
+    if (!curr || policy == TLSF || !cmp(*curr, *to_add))
     {
-        free_list.erase(block);
+        to_add->prev = nullptr;
+        to_add->next = curr;
+        if (curr)
+            curr->prev = to_add;
+        else
+            tails[fl][sl] = to_add;
+        heads[fl][sl] = to_add;
+        fl_bitmap |= (1ULL << fl);
+        sl_bitmap[fl] |= (1U << sl);
+        return;
     }
-    free_bytes -= block->size - meta_size;
-    block->is_free = false;
+    // after the tail, or look for right place inside the bin
+    if (cmp(*tails[fl][sl], *to_add))
+        curr = tails[fl][sl];
+    while (curr->next && cmp(*curr->next, *to_add))
+    {
+        curr = curr->next;
+    }
+    to_add->prev = curr;
+    to_add->next = curr->next;
+    if (curr->next)
+        curr->next->prev = to_add;
+    else
+        tails[fl][sl] = to_add;
+    curr->next = to_add;
 }
-
-void addFreeBlock(MallocMetadata *block)
+void SegregatedList::erase(MallocMetadata *to_delete)
 {
-    if (block != wilderness)
+    int fl, sl;
+    mapping(to_delete->size, &fl, &sl);
+    MallocMetadata *prev = to_delete->prev;
+    MallocMetadata *next = to_delete->next;
+    if (prev)
     {
-        free_list.push(block);
+        prev->next = next;
     }
-    free_bytes += (block->size - meta_size);
-    block->is_free = true;
+    else
+    {
+        heads[fl][sl] = next;
+        if (!next)
+        {
+            sl_bitmap[fl] &= ~(1U << sl);
+            if (!sl_bitmap[fl])
+                fl_bitmap &= ~(1ULL << fl);
+        }
+    }
+    if (next)
+    {
+        next->prev = prev;
+    }
+    else
+    {
+        tails[fl][sl] = prev;
+    }
+    this->size--;
 }
-
 /**
- * @brief merges 2 adjacent blocks. assumes previous is indeed adjacent to next from the left.
- * takes care of updating the new tip. DOESN'T envolve the free_list in any way
+ * @brief smallest block (by size, then by address) that is at least needed_size.
+ * for TLSF- some block that is at least needed_size, found in O(1)
  *
- * @param previous block
- * @param next block
- * @return MallocMetadata* of the merged block
+ * @param needed_size size in bytes, including metaData and padding
+ * @return MallocMetadata* of the best fitting block. nullptr if there is none
  */
-MallocMetadata *_merge(MallocMetadata *previous, MallocMetadata *next)
+MallocMetadata *SegregatedList::bestFit(size_t needed_size)
 {
-    previous->size += next->size;
-    previous->setTip();
-    allocated_bytes += meta_size;
-    allocated_blocks--;
-    meta_data_bytes -= meta_size;
-    // free_bytes += meta_size; // Maybe only in mergeFree?
-    return previous;
+    int fl, sl;
+    if (policy == TLSF)
+    {
+        // round up to the next bin, so that all of its blocks are large enough
+        mapping(needed_size, &fl, &sl);
+        if (fl >= SL_LOG2)
+            needed_size += (1UL << (fl - SL_LOG2)) - 1;
+        mapping(needed_size, &fl, &sl);
+        return findBin(fl, sl);
+    }
+    mapping(needed_size, &fl, &sl);
+    // the bin of needed_size may hold both smaller and larger blocks
+    for (MallocMetadata *it = heads[fl][sl]; it; it = it->next)
+    {
+        if (it->size >= needed_size)
+            return it;
+    }
+    // every block in a later bin is large enough, and heads are the smallest
+    return findBin(fl, sl + 1);
+}
+int SegregatedList::getSize()
+{
+    return this->size;
 }
 
 /**
- * @brief merge blocks to be free
- * updates only: alloc_bytes, alloc_blocks, meta_data_bytes
- * @param previous
- * @param next
- * @return MallocMetadata*
+ * Balanced search tree over the free blocks, ordered by CompareBy(DOUBLE)-
+ * (size, address). It is an AA tree (a red-black tree variant) and it is
+ * intrusive: prev/next of a block are its left/right children, and its level
+ * is kept in the word right after them, which every free block has.
+ * push, erase and bestFit are O(log n), with the same tie-breaking as the
+ * sorted list.
  */
-MallocMetadata *_mergeFree(MallocMetadata *previous, MallocMetadata *next)
+class MetaDataTree
 {
-    previous = _merge(previous, next);
-    previous->is_free = true;
-    // next->is_free = true;
-    return previous;
-}
+private:
+    int size;
+    CompareBy cmp;
+    MallocMetadata *root;
+    static size_t &level(MallocMetadata *node);
+    static size_t levelOf(MallocMetadata *node);
+    static MallocMetadata *skew(MallocMetadata *node);
+    static MallocMetadata *split(MallocMetadata *node);
+    MallocMetadata *insert(MallocMetadata *node, MallocMetadata *to_add);
+    MallocMetadata *remove(MallocMetadata *node, MallocMetadata *to_delete);
 
+public:
+    MetaDataTree();
+    ~MetaDataTree() = default;
+    void erase(MallocMetadata *to_delete);
+    void push(MallocMetadata *to_add);
+    MallocMetadata *bestFit(size_t needed_size);
+    int getSize();
+};
+MetaDataTree::MetaDataTree()
+    : size(0), cmp(DOUBLE), root(nullptr)
+{
+}
+size_t &MetaDataTree::level(MallocMetadata *node)
+{
+    return *(size_t *)((uint8_t *)node + sizeof(MallocMetadata));
+}
+size_t MetaDataTree::levelOf(MallocMetadata *node)
+{
+    return node ? level(node) : 0;
+}
 /**
- * @brief follows the same pattern as _marge but also copies the data of the block
- * to the new merged one
- * @param previous
- * @param next
- * @param which if which == 1 then next's data is copied to previous. if which == 0, opposite.
- * @return MallocMetadata* of the merged block
+ * @brief removes a left horizontal link by a right rotation
  */
-MallocMetadata *_mergeAndCopy(MallocMetadata *previous, MallocMetadata *next, int should_copy)
+MallocMetadata *MetaDataTree::skew(MallocMetadata *node)
 {
-    int next_size = next->size;
-    int previous_size = previous->size;
-    previous = _merge(previous, next);
-    if (should_copy)
-    { // move next's data to previous
-        std::memmove(PAYLOAD(previous), PAYLOAD(next), next_size - meta_size);
-        // free_bytes -= previous->size;
+    MallocMetadata *left = node->prev;
+    if (!left || level(left) != level(node))
+        return node;
+    node->prev = left->next;
+    left->next = node;
+    return left;
+}
+/**
+ * @brief removes two consecutive right horizontal links by a left rotation
+ */
+MallocMetadata *MetaDataTree::split(MallocMetadata *node)
+{
+    MallocMetadata *right = node->next;
+    if (!right || !right->next || level(right->next) != level(node))
+        return node;
+    node->next = right->prev;
+    right->prev = node;
+    level(right)++;
+    return right;
+}
+MallocMetadata *MetaDataTree::insert(MallocMetadata *node, MallocMetadata *to_add)
+{
+    if (!node)
+    {
+        to_add->prev = nullptr;
+        to_add->next = nullptr;
+        level(to_add) = 1;
+        return to_add;
+    }
+    if (cmp(*to_add, *node))
+        node->prev = insert(node->prev, to_add);
+    else
+        node->next = insert(node->next, to_add);
+    return split(skew(node));
+}
+MallocMetadata *MetaDataTree::remove(MallocMetadata *node, MallocMetadata *to_delete)
+{
+    if (!node)
+        return nullptr;
+    if (cmp(*to_delete, *node))
+    {
+        node->prev = remove(node->prev, to_delete);
+    }
+    else if (cmp(*node, *to_delete))
+    {
+        node->next = remove(node->next, to_delete);
     }
     else
     {
-        // free_bytes -= next->size;
+        if (!node->prev && !node->next)
+            return nullptr;
+        // the node can't be copied over, so its in-order neighbour takes its place
+        MallocMetadata *heir;
+        if (!node->prev)
+        {
+            for (heir = node->next; heir->prev; heir = heir->prev)
+                ;
+            node->next = remove(node->next, heir);
+        }
+        else
+        {
+            for (heir = node->prev; heir->next; heir = heir->next)
+                ;
+            node->prev = remove(node->prev, heir);
+        }
+        heir->prev = node->prev;
+        heir->next = node->next;
+        level(heir) = level(node);
+        node = heir;
     }
-    previous->is_free = false;
-    return previous;
+    // rebalance on the way up
+    size_t should_be = std::min(levelOf(node->prev), levelOf(node->next)) + 1;
+    if (should_be < level(node))
+    {
+        level(node) = should_be;
+        if (should_be < levelOf(node->next))
+            level(node->next) = should_be;
+    }
+    node = skew(node);
+    if (node->next)
+    {
+        node->next = skew(node->next);
+        if (node->next->next)
+            node->next->next = skew(node->next->next);
+    }
+    node = split(node);
+    if (node->next)
+        node->next = split(node->next);
+    return node;
+}
+void MetaDataTree::push(MallocMetadata *to_add)
+{
+    this->size++;
+    root = insert(root, to_add);
+}
+void MetaDataTree::erase(MallocMetadata *to_delete)
+{
+    this->size--;
+    root = remove(root, to_delete);
 }
-
 /**
- * @brief assuming the block is not in the free list (used)
+ * @brief smallest block (by size, then by address) that is at least needed_size
  *
- * @param block
- * @param remaining
- * @param first
- * @param second
+ * @param needed_size size in bytes, including metaData and padding
+ * @return MallocMetadata* of the best fitting block. nullptr if there is none
  */
-MallocMetadata *_split(MallocMetadata *block, int remaining)
+MallocMetadata *MetaDataTree::bestFit(size_t needed_size)
 {
-    block->size -= remaining;
-    MallocMetadata *new_block = (MallocMetadata *)((uint8_t *)block + block->size);
-    *new_block = MallocMetadata(remaining);
-    new_block->is_free = true;
-
-    // tip update:
-    MallocTip *middle_tip = block->setTip();
-    MallocTip *edge_tip = new_block->setTip();
-
-    // stats:
-    allocated_bytes -= meta_size;
-    allocated_blocks++;
-    meta_data_bytes += meta_size;
-
-    return new_block;
+    MallocMetadata *best = nullptr;
+    MallocMetadata *curr = root;
+    while (curr)
+    {
+        if (curr->size >= needed_size)
+        {
+            best = curr;
+            curr = curr->prev;
+        }
+        else
+        {
+            curr = curr->next;
+        }
+    }
+    return best;
+}
+int MetaDataTree::getSize()
+{
+    return this->size;
 }
 
+std::atomic<size_t> sbrk_calls{0}; // and segment commits, the sbrk of a segment
+std::atomic<size_t> mmap_calls{0};
+std::atomic<size_t> munmap_calls{0};
+
 /**
- * @brief finds the closest free block to "block" by memory address
- *
- * @param block to find its higher address closest neighbor
- * @return MallocMetadata* address of the neighbor if it's free, nullptr if it is used
+ * @brief sbrk, mmap and munmap, counted for the statistics
  */
-MallocMetadata *_findClosestNext(MallocMetadata *block)
+void *_sbrk(intptr_t increment)
 {
-    MallocMetadata *next_block = (MallocMetadata *)((uint8_t *)block + block->size);
-    if (next_block->is_free)
-        return next_block;
-    return nullptr;
+    if (increment != 0) // sbrk(0) doesn't make a syscall
+        sbrk_calls.fetch_add(1, std::memory_order_relaxed);
+    return sbrk(increment);
+}
+void *_mmap(void *addr, size_t length, int prot, int flags, int fd, off_t offset)
+{
+    mmap_calls.fetch_add(1, std::memory_order_relaxed);
+    return mmap(addr, length, prot, flags, fd, offset);
+}
+int _munmap(void *addr, size_t length)
+{
+    munmap_calls.fetch_add(1, std::memory_order_relaxed);
+    return munmap(addr, length);
 }
 
+enum PageKind : uint8_t
+{
+    PAGE_NONE = 0,
+    PAGE_HEAP, // sbrk heap or arena segment
+    PAGE_MMAP, // a block that has a mapping of its own
+    PAGE_SLAB,
+    PAGE_HUGE, // a block that has a mapping of its own, of huge pages
+};
+
 /**
- * @brief finds the closest block (from below) to "block" by memory address
- *
- * @param block to find its lower address closest neighbor
- * @return MallocMetadata* address of the neighbor if it's free, nullptr if it is used
+ * Three level radix tree from page number to PageKind, like tcmalloc's pagemap.
+ * Nodes are mmapped on first use and never freed. A leaf is one byte per page,
+ * so it covers 16MB of address space. get takes no lock and is three loads;
+ * nodes are installed with a CAS since arenas set pages under different locks.
  */
-MallocMetadata *_findClosestPrevious(MallocMetadata *block)
+class PageMap
 {
+private:
+    typedef std::atomic<uint8_t> Leaf[PAGEMAP_LEN];
+    typedef std::atomic<Leaf *> Node[PAGEMAP_LEN];
+    std::atomic<Node *> root[PAGEMAP_LEN];
+    template <typename T>
+    static T *getOrCreate(std::atomic<T *> &slot);
 
-    if ((void *)block <= base_addr)
-    {
+public:
+    PageKind get(const void *p);
+    bool set(const void *start, size_t length, PageKind kind);
+};
+template <typename T>
+T *PageMap::getOrCreate(std::atomic<T *> &slot)
+{
+    T *node = slot.load(std::memory_order_acquire);
+    if (node)
+        return node;
+    void *ptr = _mmap(NULL, sizeof(T), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ptr == MAP_FAILED)
         return nullptr;
+    if (!slot.compare_exchange_strong(node, (T *)ptr, std::memory_order_acq_rel, std::memory_order_acquire))
+    {
+        // another thread installed it first
+        _munmap(ptr, sizeof(T));
+        return node;
     }
-    MallocTip *prev_tip = (MallocTip *)((uint8_t *)block - sizeof(MallocTip));
-    MallocMetadata *prev_block = (MallocMetadata *)(prev_tip->front);
-    if (!prev_block)
-        return nullptr;
-    if (prev_block->is_free)
-        return prev_block;
-    return nullptr;
+    return (T *)ptr;
+}
+PageKind PageMap::get(const void *p)
+{
+    uintptr_t page = (uintptr_t)p >> PAGE_SHIFT;
+    if (page >> (3 * PAGEMAP_BITS))
+        return PAGE_NONE;
+    Node *node = root[page >> (2 * PAGEMAP_BITS)].load(std::memory_order_acquire);
+    if (!node)
+        return PAGE_NONE;
+    Leaf *leaf = (*node)[(page >> PAGEMAP_BITS) & (PAGEMAP_LEN - 1)].load(std::memory_order_acquire);
+    if (!leaf)
+        return PAGE_NONE;
+    return (PageKind)(*leaf)[page & (PAGEMAP_LEN - 1)].load(std::memory_order_relaxed);
 }
-
 /**
- * @brief finds the closest block (from below) to wilderness by memory address
+ * @brief marks every page that [start, start + length) touches
  *
- * @return MallocMetadata* address of the neighbor if it's free, nullptr if it is used
+ * @return true on success. false if a node couldn't be mapped
  */
-MallocMetadata *_previousToWilderness()
+bool PageMap::set(const void *start, size_t length, PageKind kind)
 {
-    if (wilderness->next != nullptr || wilderness->prev != nullptr)
+    uintptr_t first = (uintptr_t)start >> PAGE_SHIFT;
+    uintptr_t last = ((uintptr_t)start + length - 1) >> PAGE_SHIFT;
+    if (length == 0)
+        return true;
+    if (last >> (3 * PAGEMAP_BITS))
+        return false;
+    for (uintptr_t page = first; page <= last; page++)
     {
-        return _findClosestPrevious(wilderness);
+        Node *node = getOrCreate(root[page >> (2 * PAGEMAP_BITS)]);
+        if (!node)
+            return false;
+        Leaf *leaf = getOrCreate((*node)[(page >> PAGEMAP_BITS) & (PAGEMAP_LEN - 1)]);
+        if (!leaf)
+            return false;
+        (*leaf)[page & (PAGEMAP_LEN - 1)].store(kind, std::memory_order_relaxed);
     }
-    return nullptr;
+    return true;
 }
 
+PageMap page_map;
+
 /**
- * @brief returns the best fit possible given the size we need to allocate.
+ * @brief the start of the page that p lies in
+ */
+uint8_t *_pageOf(const void *p)
+{
+    return (uint8_t *)((uintptr_t)p & ~(uintptr_t)((1 << PAGE_SHIFT) - 1));
+}
+
+const long max_size = (1e8);
+
+#if COMPACT_HEADER
+const size_t meta_size = sizeof(size_t);
+const size_t offset = sizeof(size_t);
+#else
+const size_t meta_size = sizeof(MallocMetadata) + sizeof(MallocTip);
+const size_t offset = sizeof(MallocMetadata);
+#endif
+// a free block holds its metaData, the tree level and its tip
+const size_t min_block_size = std::max(meta_size, sizeof(MallocMetadata) + sizeof(size_t) + sizeof(MallocTip));
+#if FREE_LIST_POLICY == BEST_FIT_TREE
+typedef MetaDataTree FreeList;
+#else
+typedef SegregatedList FreeList;
+#endif
+
+// links of a large free block in a decay list. they lie right after the tree level
+struct DecayLinks
+{
+    MallocMetadata *older;
+    MallocMetadata *newer;
+    uint64_t joined; // the tick of its decay list it joined in
+};
+
+DecayLinks *_decayLinksOf(MallocMetadata *block)
+{
+    return (DecayLinks *)((uint8_t *)block + sizeof(MallocMetadata) + sizeof(size_t));
+}
+
+/**
+ * @brief the whole pages inside a free block that can be purged: everything but
+ * its metaData (with the free list links, the tree level and the decay links) and its tip
  *
- * @param size size in bytes to allocate, already including metaData and padding.
- * @return MallocMetadata* of the best free block in free_block. nullptr if couldn't find
+ * @param start set to the first of the pages
+ * @return size_t length of the pages. 0 if the block holds no whole page
  */
-MallocMetadata *_findBestFit(size_t size)
+size_t _purgeRange(MallocMetadata *block, uint8_t **start)
 {
-    for (auto it = free_list.begin(); it != free_list.end(); it = it->next)
-    {
-        if (it->size >= size) // there is enough room in this block
-        {
-            if (it->size > wilderness->size && wilderness->is_free == true)
-                return nullptr; // it's better to take wilderness
-            return it;
-        }
-    }
-    return nullptr;
+    uint8_t *first = _pageOf((uint8_t *)(_decayLinksOf(block) + 1) + (1 << PAGE_SHIFT) - 1);
+    uint8_t *last = _pageOf((uint8_t *)block + block->size - sizeof(MallocTip));
+    *start = first;
+    return (last > first) ? last - first : 0;
 }
 
 /**
- * @brief padds size to be multiple of 8, including the metaData size
- * including the tip
- * @param size the size to padd
- * @return size_t whole & divides by 8
+ * Large free blocks whose pages wait to decay, the most recent first (jemalloc
+ * style decay). backlog holds the bytes that joined the list in each of the
+ * last PURGE_DECAY_STEPS steps of the decay time. Of the bytes that joined i
+ * steps ago, smoothstep(1 - i / PURGE_DECAY_STEPS) may still be in the list, so
+ * it drains gradually, oldest blocks first, and is empty once nothing joined it
+ * for a whole decay time.
  */
-size_t padd_size(size_t size)
+class DecayList
 {
-    // some mathmatical calc
-    int full_size = size + meta_size;
-    int mod8 = full_size % 8;
-    if (mod8 == 0)
+private:
+    MallocMetadata *newest, *oldest;
+    size_t backlog[PURGE_DECAY_STEPS]; // the current step first
+    uint64_t epoch;                    // start of the current step, in ms
+    uint64_t ticks;                    // steps taken since the list was made
+
+public:
+    size_t bytes; // of the pages of all the blocks in the list
+    DecayList();
+    ~DecayList() = default;
+    MallocMetadata *getOldest();
+    void push(MallocMetadata *to_add, size_t length);
+    void erase(MallocMetadata *to_delete, size_t length, bool decayed = false);
+    void advance(uint64_t now, size_t decay_ms);
+    size_t limit();
+};
+DecayList::DecayList()
+    : newest(nullptr), oldest(nullptr), backlog(), epoch(0), ticks(0), bytes(0)
+{
+}
+MallocMetadata *DecayList::getOldest()
+{
+    return this->oldest;
+}
+void DecayList::push(MallocMetadata *to_add, size_t length)
+{
+    DecayLinks *links = _decayLinksOf(to_add);
+    links->older = newest;
+    links->newer = nullptr;
+    links->joined = ticks;
+    if (newest)
+        _decayLinksOf(newest)->newer = to_add;
+    else
+        oldest = to_add;
+    newest = to_add;
+    backlog[0] += length;
+    bytes += length;
+}
+/**
+ * @brief takes a block off the list
+ *
+ * @param decayed its pages are being purged, so they stay in the backlog
+ */
+void DecayList::erase(MallocMetadata *to_delete, size_t length, bool decayed)
+{
+    DecayLinks *links = _decayLinksOf(to_delete);
+    if (links->older)
+        _decayLinksOf(links->older)->newer = links->newer;
+    else
+        oldest = links->newer;
+    if (links->newer)
+        _decayLinksOf(links->newer)->older = links->older;
+    else
+        newest = links->older;
+    // otherwise it is used, or joins again merged or resized, and must not be counted twice
+    uint64_t age = ticks - links->joined;
+    if (!decayed && age < PURGE_DECAY_STEPS)
+        backlog[age] -= std::min(backlog[age], length);
+    bytes -= length;
+}
+/**
+ * @brief moves the backlog to the step that "now" is in
+ *
+ * @param now in ms, of CLOCK_MONOTONIC
+ */
+void DecayList::advance(uint64_t now, size_t decay_ms)
+{
+    uint64_t step = decay_ms / PURGE_DECAY_STEPS;
+    uint64_t steps = (step == 0) ? PURGE_DECAY_STEPS : (now - epoch) / step;
+    if (steps == 0)
+        return;
+    ticks += steps;
+    if (steps >= PURGE_DECAY_STEPS)
     {
-        return full_size;
+        std::fill(backlog, backlog + PURGE_DECAY_STEPS, 0);
+        epoch = now;
+        return;
     }
-    return (full_size / 8 + 1) * 8;
+    std::move_backward(backlog, backlog + PURGE_DECAY_STEPS - steps, backlog + PURGE_DECAY_STEPS);
+    std::fill(backlog, backlog + steps, 0);
+    epoch += steps * step;
 }
-
 /**
- * @brief padds size to be multiple of 8, including the metaData size
- * **not including** the tip. Used for mmap reigons
- * @param size the size to padd
- * @return size_t whole & divides by 8
+ * @brief how many bytes may stay in the list by the decay curve
  */
-size_t padd_size_no_tip(size_t size)
+size_t DecayList::limit()
 {
-    int full_size = size + sizeof(MallocMetadata);
-    int mod8 = full_size % 8;
-    if (mod8 == 0)
+    double sum = 0;
+    for (int i = 0; i < PURGE_DECAY_STEPS; i++)
     {
-        return full_size;
+        double x = 1 - (double)i / PURGE_DECAY_STEPS;
+        sum += backlog[i] * x * x * (3 - 2 * x);
     }
-    return (full_size / 8 + 1) * 8;
+    return (size_t)sum;
 }
 
-bool isSplitable(const int remainder)
+/**
+ * @brief the time for the decay lists, in ms
+ */
+uint64_t _nowMs()
 {
-    return ((int)(remainder - meta_size) >= SPLIT_SIZE);
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
 }
 
-void *smalloc(size_t size)
+/**
+ * @brief what an arena counts for one size class. the counters are only
+ * touched under the arena's lock
+ */
+struct SizeClassStats
 {
-    if (size == 0 || size > max_size)
-    {
-        return nullptr;
-    }
+    size_t allocs = 0;
+    size_t frees = 0;
+    size_t live_bytes = 0; // payload bytes of the live blocks
+    size_t splits = 0;
+    size_t merges = 0;
+};
 
-    if (!initialized)
-        initialize();
+/**
+ * @brief the size class of a block, for the statistics
+ */
+int _sizeClass(size_t block_size)
+{
+    return 63 - __builtin_clzl(block_size);
+}
 
-    // metaData size + 8-multiple padding
+/**
+ * An arena is a complete heap of its own: free list, wilderness,
+ * statistics and lock. Arena 0 grows with sbrk, every other arena (and arena 0
+ * too with USE_SEGMENTS) grows inside mmap segments of ARENA_SEGMENT_SIZE bytes.
+ * A segment is only reserved, its pages are committed as the heap grows into
+ * them. When it is full, its top gets a used fence block, so no block merges
+ * past it, its wilderness becomes a regular block, and the heap goes on in a
+ * new segment.
+ * Threads are bound to arenas round robin on their first allocation, and every
+ * block records its arena in its metaData, so sfree returns it to its owner.
+ * With USE_REMOTE_FREE, a thread that frees a block of another arena doesn't
+ * take that arena's lock. It pushes the block on the arena's remote_frees stack
+ * with a single CAS, and the arena frees the whole stack at once the next time
+ * one of its threads allocates.
+ * With USE_FASTBINS, freed blocks of up to FASTBIN_MAX_SIZE bytes go to exact
+ * size LIFO fast bins instead of being merged. Like a cached block they stay
+ * used as far as the heap is concerned, so neither their neighbours nor the
+ * statistics see them. They are consolidated (freed for real) when a request
+ * misses the free list, or when they hold more than FASTBIN_BUDGET bytes.
+ * With USE_PURGE, free blocks of PURGE_MIN_SIZE bytes or more give their whole
+ * pages back to the OS with MADV_DONTNEED, and are marked clean. The pages read
+ * as zero from then on, so scalloc doesn't clear them when the block is reused.
+ * With a decay time (PURGE_DECAY_MS, or sset_purge_decay), sfree only puts them
+ * in the dirty decay list. A background thread then makes them muzzy
+ * (MADV_FREE) and at last clean, each over the decay time, so the syscalls stay
+ * off the threads that allocate.
+ */
+class Arena
+{
+public:
+    uint16_t id;
+    pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+    FreeList free_list;
+    MallocMetadata *wilderness = nullptr; // may be free and may not. Thus - not in free_list!
+    size_t free_blocks = 0;
+    size_t free_bytes = 0;
+    size_t allocated_blocks = 0; // total num of blocks
+    size_t allocated_bytes = 0;
+    size_t meta_data_bytes = 0;
+    void *base_addr = nullptr;
+    bool initialized = false;
+    uint8_t *segment = nullptr; // the newest segment, only for arenas that don't use sbrk
+    size_t segment_size = 0;
+    size_t segment_used = 0;
+    size_t segment_committed = 0;
+    size_t segments = 0;
+    std::atomic<MallocMetadata *> remote_frees{nullptr}; // linked by next
+    MallocMetadata *fast_bins[FASTBIN_CLASSES] = {nullptr}; // linked by next
+    size_t fast_bytes = 0;
+    size_t purged_bytes = 0;
+    DecayList dirty_pages;
+    DecayList muzzy_pages;
+    SizeClassStats size_classes[STATS_CLASSES];
+    size_t mmap_blocks = 0;
+    size_t mmap_bytes = 0;
+    size_t live_bytes = 0;
+    size_t peak_live_bytes = 0;
 
-    size = padd_size(size);
-    if (size >= LARGE_MEM) // mmap size
-    {
-        void *ptr = mmap(0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
-        if (ptr == MAP_FAILED)
-        {
-            return nullptr;
-        }
-        MallocMetadata *new_mmap = (MallocMetadata *)(ptr);
-        *new_mmap = MallocMetadata(size);
-        new_mmap->is_free = false;
+    void initialize();
+    void *extendHeap(intptr_t increment);
+    size_t _growHeap(size_t addition);
+    void *_splitWilderness(size_t size);
+    bool _canExtend(size_t addition);
+    bool _commitSegment(size_t used);
+    bool _newSegment(size_t size);
+    bool _roomForWilderness(size_t size);
+    size_t trim(size_t pad);
+    void _trimIfLarge();
+    void remoteFree(MallocMetadata *block);
+    void drainRemoteFrees();
+    bool _fastFree(MallocMetadata *block);
+    MallocMetadata *_fastMalloc(size_t size);
+    void consolidate();
+    void updateMmapAdd(MallocMetadata *mmap_block);
+    void _statAlloc(size_t block_size);
+    void _statFree(size_t block_size);
+    void updateMmapRemove(MallocMetadata *mmap_block);
+    void eraseFreeBlock(MallocMetadata *block);
+    void addFreeBlock(MallocMetadata *block);
+    void _trackPages(MallocMetadata *block);
+    void _untrackPages(MallocMetadata *block, bool decayed = false);
+    void _purgePages(MallocMetadata *block, PageState state);
+    bool decayStep(uint64_t now, size_t decay_ms);
+    size_t purgeAll();
+    void _updateNext(MallocMetadata *block);
+    bool _createWilderness();
+    MallocMetadata *_merge(MallocMetadata *previous, MallocMetadata *next);
+    MallocMetadata *_mergeFree(MallocMetadata *previous, MallocMetadata *next);
+    MallocMetadata *_mergeAndCopy(MallocMetadata *previous, MallocMetadata *next, int should_copy);
+    MallocMetadata *_split(MallocMetadata *block, int remaining);
+    MallocMetadata *_findClosestNext(MallocMetadata *block);
+    MallocMetadata *_findClosestPrevious(MallocMetadata *block);
+    MallocMetadata *_previousToWilderness();
+    MallocMetadata *_findBestFit(size_t size);
+    MallocMetadata *_mmapMalloc(size_t size, bool huge, bool *reused = nullptr);
+    MallocMetadata *_mremapBlock(MallocMetadata *block, size_t size);
+    void *_heapMalloc(size_t size, bool *purged = nullptr);
+    void *_heapCalloc(size_t size);
+    void *_heapMemalign(size_t alignment, size_t size);
+    void *_mmapMemalign(size_t alignment, size_t size);
+    MallocMetadata *_carve(MallocMetadata *block, size_t size);
+    void _carveBatch(MallocMetadata *block, size_t size, size_t count, void **out_ptrs);
+    size_t _heapMallocBatch(size_t size, size_t count, void **out_ptrs);
+    void _heapFreeBatch(void **ptrs, size_t count);
+    void *_smalloc(size_t size, MallocMetadata *to_copy);
+    void _heapFree(void *p);
+    void *_heapRealloc(void *oldp, size_t size);
+};
 
-        mmap_list.push(new_mmap);
-        // stats:
-        updateMmapAdd(new_mmap);
-        return PAYLOAD(new_mmap);
-    }
+class ArenaLock
+{
+    Arena *arena;
 
-    if (!wilderness)
-    {
-        void *ptr = sbrk(meta_size);
-        if (ptr == (void *)(-1))
-        {
-            return nullptr;
-        }
-        wilderness = (MallocMetadata *)ptr;
-        wilderness->size = meta_size;
-        wilderness->is_free = true;
-        wilderness->next = nullptr;
-        wilderness->prev = nullptr;
+public:
+    ArenaLock(Arena *arena) : arena(arena) { pthread_mutex_lock(&arena->lock); }
+    ~ArenaLock() { pthread_mutex_unlock(&arena->lock); }
+};
 
-        // stats:
-        allocated_blocks++; // total num of blocks
-        meta_data_bytes += meta_size;
+Arena arenas[MAX_ARENAS];
+int num_arenas = 0;
+pthread_once_t arenas_once = PTHREAD_ONCE_INIT;
+
+void _setupArenas()
+{
+    num_arenas = ARENAS;
+    if (num_arenas <= 0)
+        num_arenas = sysconf(_SC_NPROCESSORS_ONLN);
+    num_arenas = std::max(1, std::min(num_arenas, MAX_ARENAS));
+    for (int i = 0; i < MAX_ARENAS; i++)
+    {
+        arenas[i].id = i;
     }
+}
 
-    // look for best free block in free_list
-    MallocMetadata *block = _findBestFit(size);
+void Arena::initialize()
+{
+    if (initialized)
+        return;
+    initialized = true;
+    if (id != 0 || USE_SEGMENTS)
+        return;
+    base_addr = _sbrk(0);
+    long address = (long)base_addr;
+    if (address % 8 != 0)
+    {
+        int add = 8 - address % 8;
+        _sbrk(add);
+    }
+}
 
-    if (block != nullptr) // we found a block
+/**
+ * @brief sbrk for this arena- moves the top of its heap
+ *
+ * @param increment bytes to add. may be negative, and then the pages above the new top are given back
+ * @return void* the old top, or (void *)(-1) on failure
+ */
+void *Arena::extendHeap(intptr_t increment)
+{
+    if (id == 0 && !USE_SEGMENTS)
     {
-        eraseFreeBlock(block);
-        int remaining = block->size - size;
-        if (isSplitable(remaining)) // to split or not to split?
+        void *old_top = _sbrk(increment);
+        if (old_top != (void *)(-1) && increment > 0 && !page_map.set(old_top, increment, PAGE_HEAP))
         {
-            MallocMetadata *new_block = _split(block, remaining);
-            // list update:
-            addFreeBlock(new_block);
+            _sbrk(-increment);
+            return (void *)(-1);
         }
-        return PAYLOAD(block);
+        if (old_top != (void *)(-1) && increment < 0)
+            page_map.set((uint8_t *)old_top + increment, -increment, PAGE_NONE);
+        return old_top;
     }
-    // reaching here means we couldn't find a large enough spot in the free_list
-    // let's try wilderness instead:
-    if (wilderness->is_free)
+    if (!segment && !_newSegment(0))
+        return (void *)(-1);
+    if (increment > 0 && !_canExtend(increment))
+        return (void *)(-1);
+    void *old_top = segment + segment_used;
+    if (increment > 0 && (!_commitSegment(segment_used + increment) || !page_map.set(old_top, increment, PAGE_HEAP)))
+        return (void *)(-1);
+    if (increment < 0)
     {
-        if (wilderness->size >= size)
+        // the segment stays reserved, only its pages are given back and decommitted
+        size_t committed = _pageOf(segment + segment_used + increment + (1 << PAGE_SHIFT) - 1) - segment;
+        if (committed < segment_committed)
         {
-            if (isSplitable(wilderness->size - size))
-            {
-                eraseFreeBlock(wilderness);
-                MallocMetadata *old_wilderness = wilderness;
-                wilderness = _split(wilderness, wilderness->size - size);
-                addFreeBlock(wilderness);
-                return PAYLOAD(old_wilderness);
-            }
-            else
-            {
-                // no splitting - no need to update the Tips or size
-                wilderness->is_free = false;
-
-                // stats:
-                free_bytes -= (wilderness->size - meta_size);
-                return PAYLOAD(wilderness);
-            }
+            madvise(segment + committed, segment_committed - committed, MADV_DONTNEED);
+            mprotect(segment + committed, segment_committed - committed, PROT_NONE);
+            sbrk_calls.fetch_add(1, std::memory_order_relaxed);
+            segment_committed = committed;
         }
-        else
-        {
-            // need to sbrk()
-            int addition = size - wilderness->size;
-            void *ptr = sbrk(addition);
-            if (ptr == (void *)(-1))
-            {
-                return nullptr;
-            }
-            // bool was_empty = wilderness->size == meta_size;
-            wilderness->size = size;
-            wilderness->is_free = false;
+        page_map.set(segment + segment_used + increment, -increment, PAGE_NONE);
+    }
+    segment_used += increment;
+    return old_top;
+}
 
-            // tip update:
-            wilderness->setTip();
+/**
+ * @brief whether the top of the heap can move up by "addition" bytes. the sbrk
+ * heap can always try, a segment keeps room for its fence block at its end
+ */
+bool Arena::_canExtend(size_t addition)
+{
+    return !segment || segment_used + addition + sizeof(MallocMetadata) <= segment_size;
+}
 
-            // stats:
-            free_bytes -= (wilderness->size - addition - meta_size);
-            allocated_bytes += addition;
-            return PAYLOAD(wilderness);
-        }
-    }
-    else // need to assign new wilderness and use it
+/**
+ * @brief commits the pages of the newest segment, up to its first "used" bytes
+ *
+ * @return true on success
+ */
+bool Arena::_commitSegment(size_t used)
+{
+    size_t committed = _pageOf(segment + used + (1 << PAGE_SHIFT) - 1) - segment;
+    if (committed <= segment_committed)
+        return true;
+    sbrk_calls.fetch_add(1, std::memory_order_relaxed);
+    if (mprotect(segment + segment_committed, committed - segment_committed, PROT_READ | PROT_WRITE) != 0)
+        return false;
+    segment_committed = committed;
+    return true;
+}
+
+/**
+ * @brief reserves a new segment with room for a block of "size" bytes, and
+ * moves the heap on to it. the segment it was in gets a used fence block at its
+ * top, and its wilderness becomes a regular block. the new segment has no
+ * wilderness yet
+ *
+ * @return true on success
+ */
+bool Arena::_newSegment(size_t size)
+{
+    size_t page_mask = ((size_t)1 << PAGE_SHIFT) - 1;
+    size_t length = std::max((size_t)ARENA_SEGMENT_SIZE, (size + sizeof(MallocMetadata) + page_mask) & ~page_mask);
+    void *ptr = _mmap(NULL, length, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (ptr == MAP_FAILED)
+        return false;
+    if (wilderness)
     {
-        void *ptr = sbrk(size);
-        if (ptr == (void *)(-1))
+        if (!_commitSegment(segment_used + sizeof(MallocMetadata)))
         {
-            return nullptr;
+            _munmap(ptr, length);
+            return false;
         }
-        MallocMetadata *new_wilderness = (MallocMetadata *)((uint8_t *)wilderness + wilderness->size);
-        *new_wilderness = MallocMetadata(size);
-        new_wilderness->is_free = false;
-
-        // create new tip:
-        new_wilderness->setTip();
-
-        // update wilderness
-        wilderness = new_wilderness;
-
-        // stats:
-        allocated_blocks++;
-        allocated_bytes += (size - meta_size);
-        meta_data_bytes += meta_size;
+        MallocMetadata *fence = (MallocMetadata *)(segment + segment_used);
+        *fence = MallocMetadata(sizeof(MallocMetadata), id);
+        fence->is_free = false;
+        segment_used += sizeof(MallocMetadata);
+        MallocMetadata *old_wilderness = wilderness;
+        bool was_free = old_wilderness->is_free;
+        if (was_free)
+            eraseFreeBlock(old_wilderness);
+        wilderness = nullptr;
+        if (was_free)
+            addFreeBlock(old_wilderness); // into free_list, and sets the fence's prev_free
     }
-    wilderness->is_free = false;
-    return PAYLOAD(wilderness);
+    segment = (uint8_t *)ptr;
+    segment_size = length;
+    segment_used = 0;
+    segment_committed = 0;
+    segments++;
+    return true;
 }
 
-void *scalloc(size_t num, size_t size)
+/**
+ * @brief makes sure the wilderness can become a block of "size" bytes. if the
+ * segment it is in is full, the heap moves on to a new one
+ *
+ * @return true on success
+ */
+bool Arena::_roomForWilderness(size_t size)
 {
-    size_t total_size = num * size;
-    void *ptr = smalloc(total_size);
-    if (!ptr)
-        return ptr;
-    std::memset(ptr, 0, total_size);
-    return ptr;
+    size_t free = wilderness->is_free ? std::min(size, (size_t)wilderness->size) : 0;
+    if (_canExtend(size - free))
+        return true;
+    return segment && _newSegment(size) && _createWilderness();
 }
 
-void *_smalloc(size_t size, MallocMetadata *to_copy)
+/**
+ * @brief pushes a block of this arena on its remote free stack.
+ * lock free- may be called by any thread without holding the arena's lock
+ */
+void Arena::remoteFree(MallocMetadata *block)
 {
-    uint8_t *p = (uint8_t *)smalloc(size);
-    MallocMetadata *new_meta = ((MallocMetadata *)(p - offset));
-    std::memmove(PAYLOAD(new_meta), PAYLOAD(to_copy), to_copy->size - meta_size);
-    return PAYLOAD(new_meta);
-
+    MallocMetadata *head = remote_frees.load(std::memory_order_relaxed);
+    do
+    {
+        block->next = head;
+    } while (!remote_frees.compare_exchange_weak(head, block, std::memory_order_release, std::memory_order_relaxed));
 }
 
-void sfree(void *p)
+/**
+ * @brief frees every block that other threads pushed on the remote free stack.
+ * the arena's lock must be held
+ */
+void Arena::drainRemoteFrees()
 {
-    if (!p)
+    if (!remote_frees.load(std::memory_order_relaxed))
         return;
+    MallocMetadata *block = remote_frees.exchange(nullptr, std::memory_order_acquire);
+    while (block)
+    {
+        MallocMetadata *next = block->next;
+        _statFree(block->size);
+        _heapFree(PAYLOAD(block));
+        block = next;
+    }
+}
 
-    if (!initialized)
-        initialize();
+/**
+ * @brief puts a block that is being freed in its fast bin
+ *
+ * @return true if the block was binned. false if it should be freed for real
+ */
+bool Arena::_fastFree(MallocMetadata *block)
+{
+    // already free blocks (split remainders) and the wilderness are merged right away
+    if (block->size > FASTBIN_MAX_SIZE || block->is_free || block == wilderness)
+        return false;
+    int size_class = block->size / 8 - 1;
+    block->next = fast_bins[size_class];
+    fast_bins[size_class] = block;
+    fast_bytes += block->size;
+    if (fast_bytes > FASTBIN_BUDGET)
+        consolidate();
+    return true;
+}
 
-    MallocMetadata *meta = ((MallocMetadata *)((uint8_t *)p - offset));
-    // if (meta->is_free)
-    //     return;
+/**
+ * @brief pops a block of exactly the given size from its fast bin
+ *
+ * @param size block size, metaData and padding included
+ * @return MallocMetadata* nullptr if the bin is empty
+ */
+MallocMetadata *Arena::_fastMalloc(size_t size)
+{
+    if (size > FASTBIN_MAX_SIZE)
+        return nullptr;
+    int size_class = size / 8 - 1;
+    MallocMetadata *block = fast_bins[size_class];
+    if (block)
+    {
+        fast_bins[size_class] = block->next;
+        fast_bytes -= block->size;
+    }
+    return block;
+}
 
-    // check and handle if mmapped
-    if (meta->size >= LARGE_MEM)
+/**
+ * @brief frees every block in the fast bins, merging it with its free neighbours
+ */
+void Arena::consolidate()
+{
+    for (int size_class = 0; size_class < FASTBIN_CLASSES; size_class++)
     {
-        if (mmap_list.find(meta) == false)
-            return;
-        mmap_list.erase(meta);
-        updateMmapRemove(meta);
-        int err = munmap(meta, meta->size);
-        if (err != 0)
+        MallocMetadata *block = fast_bins[size_class];
+        fast_bins[size_class] = nullptr;
+        while (block)
         {
-            perror("unmapping failed.\n");
-            return;
+            MallocMetadata *next = block->next;
+            block->is_free = true; // so _heapFree doesn't bin it again
+            _heapFree(PAYLOAD(block));
+            block = next;
         }
-        return;
     }
+    fast_bytes = 0;
+}
 
-    // check and handle if wilderness is meta
+void Arena::updateMmapAdd(MallocMetadata *mmap_block)
+{
+    allocated_blocks++;
+    allocated_bytes += mmap_block->size - meta_size;
+    mmap_blocks++;
+    mmap_bytes += mmap_block->size - meta_size;
+    // meta_data_bytes += sizeof(MallocMetadata);
+}
+
+void Arena::updateMmapRemove(MallocMetadata *mmap_block)
+{
+    allocated_blocks--;
+    allocated_bytes -= mmap_block->size - meta_size;
+    mmap_blocks--;
+    mmap_bytes -= mmap_block->size - meta_size;
+    // meta_data_bytes -= sizeof(MallocMetadata);
+}
+
+/**
+ * @brief counts a block this arena handed out. blocks held by the fast bins
+ * and the thread caches stay live, as far as the counters are concerned
+ */
+void Arena::_statAlloc(size_t block_size)
+{
+    SizeClassStats &stats = size_classes[_sizeClass(block_size)];
+    stats.allocs++;
+    stats.live_bytes += block_size - meta_size;
+    live_bytes += block_size - meta_size;
+    peak_live_bytes = std::max(peak_live_bytes, live_bytes);
+}
+
+/**
+ * @brief counts a block that was given back to this arena
+ */
+void Arena::_statFree(size_t block_size)
+{
+    SizeClassStats &stats = size_classes[_sizeClass(block_size)];
+    stats.frees++;
+    stats.live_bytes -= block_size - meta_size;
+    live_bytes -= block_size - meta_size;
+}
+
+void Arena::eraseFreeBlock(MallocMetadata *block)
+{
+    if (USE_PURGE)
+        _untrackPages(block);
+    if (block != wilderness)
+    {
+        free_list.erase(block);
+    }
+    free_bytes -= block->size - meta_size;
+    block->is_free = false;
+    _updateNext(block);
+}
+
+void Arena::addFreeBlock(MallocMetadata *block)
+{
+    if (block != wilderness)
+    {
+        free_list.push(block);
+    }
+    free_bytes += (block->size - meta_size);
+    block->is_free = true;
+    block->setTip();
+    _updateNext(block);
+    if (USE_PURGE)
+        _trackPages(block);
+}
+
+/**
+ * @brief sets the prev_free bit of the block right above "block".
+ * the wilderness has no block above it
+ */
+void Arena::_updateNext(MallocMetadata *block)
+{
+    if (block == wilderness)
+        return;
+    MallocMetadata *next_block = (MallocMetadata *)((uint8_t *)block + block->size);
+    next_block->prev_free = block->is_free;
+}
+
+/**
+ * @brief creates the first block of the heap- a free wilderness as small as a block can be
+ *
+ * @return true on success
+ */
+bool Arena::_createWilderness()
+{
+    void *ptr = extendHeap(min_block_size);
+    if (ptr == (void *)(-1))
+    {
+        return false;
+    }
+    wilderness = (MallocMetadata *)ptr;
+    base_addr = ptr; // first block of the heap, or of its newest segment
+    *wilderness = MallocMetadata(min_block_size, id);
+    wilderness->next = nullptr;
+    wilderness->prev = nullptr;
+
+    // stats:
+    allocated_blocks++; // total num of blocks
+    allocated_bytes += min_block_size - meta_size;
+    free_bytes += min_block_size - meta_size;
+    meta_data_bytes += meta_size;
+    return true;
+}
+
+/**
+ * @brief merges 2 adjacent blocks. assumes previous is indeed adjacent to next from the left.
+ * takes care of updating the new tip. DOESN'T envolve the free_list in any way
+ *
+ * @param previous block
+ * @param next block
+ * @return MallocMetadata* of the merged block
+ */
+MallocMetadata *Arena::_merge(MallocMetadata *previous, MallocMetadata *next)
+{
+    previous->size += next->size;
+    previous->setTip();
+    size_classes[_sizeClass(previous->size)].merges++;
+    allocated_bytes += meta_size;
+    allocated_blocks--;
+    meta_data_bytes -= meta_size;
+    // free_bytes += meta_size; // Maybe only in mergeFree?
+    return previous;
+}
+
+/**
+ * @brief merge blocks to be free
+ * updates only: alloc_bytes, alloc_blocks, meta_data_bytes
+ * @param previous
+ * @param next
+ * @return MallocMetadata*
+ */
+MallocMetadata *Arena::_mergeFree(MallocMetadata *previous, MallocMetadata *next)
+{
+    previous = _merge(previous, next);
+    previous->is_free = true;
+    // next->is_free = true;
+    if (next != wilderness)
+        _updateNext(previous);
+    return previous;
+}
+
+/**
+ * @brief follows the same pattern as _marge but also copies the data of the block
+ * to the new merged one
+ * @param previous
+ * @param next
+ * @param which if which == 1 then next's data is copied to previous. if which == 0, opposite.
+ * @return MallocMetadata* of the merged block
+ */
+MallocMetadata *Arena::_mergeAndCopy(MallocMetadata *previous, MallocMetadata *next, int should_copy)
+{
+    int next_size = next->size;
+    previous = _merge(previous, next);
+    if (should_copy)
+    { // move next's data to previous
+        std::memmove(PAYLOAD(previous), PAYLOAD(next), next_size - meta_size);
+        // free_bytes -= previous->size;
+    }
+    else
+    {
+        // free_bytes -= next->size;
+    }
+    previous->is_free = false;
+    if (next != wilderness)
+        _updateNext(previous);
+    return previous;
+}
+
+/**
+ * @brief assuming the block is not in the free list (used)
+ *
+ * @param block
+ * @param remaining
+ * @param first
+ * @param second
+ */
+MallocMetadata *Arena::_split(MallocMetadata *block, int remaining)
+{
+    size_classes[_sizeClass(block->size)].splits++;
+    block->size -= remaining;
+    MallocMetadata *new_block = (MallocMetadata *)((uint8_t *)block + block->size);
+    *new_block = MallocMetadata(remaining, id);
+    new_block->is_free = true;
+    new_block->prev_free = block->is_free;
+    if (block != wilderness)
+        _updateNext(new_block);
+
+    // tip update:
+    block->setTip();
+    new_block->setTip();
+
+    // stats:
+    allocated_bytes -= meta_size;
+    allocated_blocks++;
+    meta_data_bytes += meta_size;
+
+    return new_block;
+}
+
+/**
+ * @brief finds the closest free block to "block" by memory address
+ *
+ * @param block to find its higher address closest neighbor
+ * @return MallocMetadata* address of the neighbor if it's free, nullptr if it is used
+ */
+MallocMetadata *Arena::_findClosestNext(MallocMetadata *block)
+{
+    MallocMetadata *next_block = (MallocMetadata *)((uint8_t *)block + block->size);
+    if (next_block->is_free)
+        return next_block;
+    return nullptr;
+}
+
+/**
+ * @brief finds the closest block (from below) to "block" by memory address
+ *
+ * @param block to find its lower address closest neighbor
+ * @return MallocMetadata* address of the neighbor if it's free, nullptr if it is used
+ */
+MallocMetadata *Arena::_findClosestPrevious(MallocMetadata *block)
+{
+    // the first block of the heap, and of every segment, has prev_free unset
+    if (!block->prev_free)
+    {
+        return nullptr;
+    }
+    MallocTip *prev_tip = (MallocTip *)((uint8_t *)block - sizeof(MallocTip));
+    MallocMetadata *prev_block = (MallocMetadata *)(prev_tip->front);
+    if (!prev_block)
+        return nullptr;
+    if (prev_block->is_free)
+        return prev_block;
+    return nullptr;
+}
+
+/**
+ * @brief finds the closest block (from below) to wilderness by memory address
+ *
+ * @return MallocMetadata* address of the neighbor if it's free, nullptr if it is used
+ */
+MallocMetadata *Arena::_previousToWilderness()
+{
+    return _findClosestPrevious(wilderness);
+}
+
+/**
+ * @brief returns the best fit possible given the size we need to allocate.
+ *
+ * @param size size in bytes to allocate, already including metaData and padding.
+ * @return MallocMetadata* of the best free block in free_block. nullptr if couldn't find
+ */
+MallocMetadata *Arena::_findBestFit(size_t size)
+{
+    MallocMetadata *block = free_list.bestFit(size);
+    if (block == nullptr)
+        return nullptr;
+    if (block->size > wilderness->size && wilderness->is_free == true)
+        return nullptr; // it's better to take wilderness
+    return block;
+}
+
+/**
+ * @brief padds size to be multiple of 8, including the metaData size
+ * including the tip
+ * @param size the size to padd
+ * @return size_t whole & divides by 8
+ */
+size_t padd_size(size_t size)
+{
+    // some mathmatical calc
+    int full_size = std::max(size + meta_size, min_block_size);
+    int mod8 = full_size % 8;
+    if (mod8 == 0)
+    {
+        return full_size;
+    }
+    return (full_size / 8 + 1) * 8;
+}
+
+/**
+ * @brief padds size to be multiple of 8, including the metaData size
+ * **not including** the tip. Used for mmap reigons
+ * @param size the size to padd
+ * @return size_t whole & divides by 8
+ */
+size_t padd_size_no_tip(size_t size)
+{
+    int full_size = size + sizeof(MallocMetadata);
+    int mod8 = full_size % 8;
+    if (mod8 == 0)
+    {
+        return full_size;
+    }
+    return (full_size / 8 + 1) * 8;
+}
+
+bool isSplitable(const int remainder)
+{
+    return ((int)(remainder - meta_size) >= SPLIT_SIZE);
+}
+
+// whole blocks of this size (metaData included) or larger are mmapped.
+// starts at LARGE_MEM and only moves with DYNAMIC_MMAP_THRESHOLD
+std::atomic<size_t> mmap_threshold{LARGE_MEM};
+// a free wilderness with a payload larger than this is trimmed. 0 never trims
+std::atomic<size_t> trim_threshold{TRIM_THRESHOLD};
+// time for free pages to decay, in ms. 0 purges them in sfree
+std::atomic<size_t> purge_decay_ms{PURGE_DECAY_MS};
+std::atomic<bool> decay_thread{false};
+pthread_once_t decay_once = PTHREAD_ONCE_INIT;
+
+bool _isLarge(size_t block_size)
+{
+    return block_size >= mmap_threshold.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief a block of this size was mmapped and is now freed. if it is above the
+ * threshold, blocks of its size are being reused, and it's cheaper to keep them
+ * on the heap from now on. the threshold never passes DEFAULT_MMAP_THRESHOLD_MAX
+ *
+ * @param block_size whole block, metaData included
+ */
+void _raiseMmapThreshold(size_t block_size)
+{
+    if (block_size - meta_size <= DEFAULT_MMAP_THRESHOLD_MAX &&
+        block_size > mmap_threshold.load(std::memory_order_relaxed))
+    {
+        mmap_threshold.store(block_size, std::memory_order_relaxed);
+        // don't trim what would now be allocated on the heap right away
+        if (TRIM_THRESHOLD)
+            trim_threshold.store(2 * block_size, std::memory_order_relaxed);
+    }
+}
+
+/**
+ * @brief the block has a mapping of its own (of regular or huge pages)
+ */
+bool _isMapped(MallocMetadata *block)
+{
+    PageKind kind = page_map.get(block);
+    return kind == PAGE_MMAP || kind == PAGE_HUGE;
+}
+
+/**
+ * Cache of freed mmap regions (only when USE_MMAP_CACHE is set). An mmapped
+ * block that is freed keeps its mapping here, and the next large allocation of
+ * about its size takes it back with no syscall and no page faults. Regions are
+ * bucketed by the power of 2 of their length. A region larger than the request
+ * is split, and its tail stays cached. The oldest regions are unmapped when the
+ * cache holds more than MMAP_CACHE_BUDGET bytes, or when they were not reused
+ * for MMAP_CACHE_MAX_AGE_MS. Cached pages are dirty, so scalloc clears them.
+ */
+struct CachedRegion // at the start of the region
+{
+    size_t length; // whole pages
+    uint64_t freed_at; // in ms
+    CachedRegion *next, *prev; // in its bucket
+    CachedRegion *older, *newer;
+};
+
+pthread_mutex_t mmap_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+CachedRegion *mmap_cache[64] = {nullptr};
+CachedRegion *cache_oldest = nullptr, *cache_newest = nullptr;
+size_t mmap_cache_bytes = 0;
+size_t mmap_cache_hits = 0;
+size_t mmap_cache_misses = 0;
+
+int _cacheBucket(size_t length)
+{
+    return 63 - __builtin_clzll(length);
+}
+
+void _cacheInsert(CachedRegion *region)
+{
+    CachedRegion **bucket = &mmap_cache[_cacheBucket(region->length)];
+    region->prev = nullptr;
+    region->next = *bucket;
+    if (*bucket)
+        (*bucket)->prev = region;
+    *bucket = region;
+    region->older = cache_newest;
+    region->newer = nullptr;
+    if (cache_newest)
+        cache_newest->newer = region;
+    else
+        cache_oldest = region;
+    cache_newest = region;
+
+    // stats:
+    mmap_cache_bytes += region->length;
+}
+
+void _cacheRemove(CachedRegion *region)
+{
+    if (region->prev)
+        region->prev->next = region->next;
+    else
+        mmap_cache[_cacheBucket(region->length)] = region->next;
+    if (region->next)
+        region->next->prev = region->prev;
+    if (region->older)
+        region->older->newer = region->newer;
+    else
+        cache_oldest = region->newer;
+    if (region->newer)
+        region->newer->older = region->older;
+    else
+        cache_newest = region->older;
+
+    // stats:
+    mmap_cache_bytes -= region->length;
+}
+
+/**
+ * @brief unmaps the oldest regions while the cache is over its budget, or they are too old
+ */
+void _cacheEvict(uint64_t now)
+{
+    while (cache_oldest &&
+           (mmap_cache_bytes > MMAP_CACHE_BUDGET || now - cache_oldest->freed_at > MMAP_CACHE_MAX_AGE_MS))
+    {
+        CachedRegion *region = cache_oldest;
+        _cacheRemove(region);
+        _munmap(region, region->length);
+    }
+}
+
+/**
+ * @brief keeps a freed mapping in the cache
+ *
+ * @param length whole pages
+ * @return true if it was cached. false if it is too large, and should be unmapped
+ */
+bool _mmapCachePut(void *start, size_t length)
+{
+    if (length > MMAP_CACHE_BUDGET / 4)
+        return false;
+    pthread_mutex_lock(&mmap_cache_lock);
+    uint64_t now = _nowMs();
+    CachedRegion *region = (CachedRegion *)start;
+    region->length = length;
+    region->freed_at = now;
+    _cacheInsert(region);
+    _cacheEvict(now);
+    pthread_mutex_unlock(&mmap_cache_lock);
+    return true;
+}
+
+/**
+ * @brief takes a cached region of exactly the pages that size needs
+ *
+ * @param size in bytes
+ * @return void* the region. nullptr if no cached region is large enough
+ */
+void *_mmapCacheGet(size_t size)
+{
+    size_t length = (size + (1 << PAGE_SHIFT) - 1) & ~(size_t)((1 << PAGE_SHIFT) - 1);
+    pthread_mutex_lock(&mmap_cache_lock);
+    uint64_t now = _nowMs();
+    _cacheEvict(now);
+    CachedRegion *region = nullptr;
+    for (int bucket = _cacheBucket(length); bucket < 64 && !region; bucket++)
+    {
+        region = mmap_cache[bucket];
+        while (region && region->length < length)
+            region = region->next;
+    }
+    if (region)
+    {
+        _cacheRemove(region);
+        if (region->length > length)
+        {
+            CachedRegion *tail = (CachedRegion *)((uint8_t *)region + length);
+            tail->length = region->length - length;
+            tail->freed_at = region->freed_at;
+            _cacheInsert(tail);
+        }
+    }
+
+    // stats:
+    if (region)
+        mmap_cache_hits++;
+    else
+        mmap_cache_misses++;
+    pthread_mutex_unlock(&mmap_cache_lock);
+    return region;
+}
+
+/**
+ * @brief unmaps an mmapped block and clears it from the page map.
+ * aligned blocks may start in the middle of their first page, and a mapping of
+ * huge pages must be unmapped in whole huge pages. with USE_MMAP_CACHE,
+ * mappings of regular pages are cached instead
+ *
+ * @return int munmap's result
+ */
+int _unmapBlock(MallocMetadata *block)
+{
+    uint8_t *start = _pageOf(block);
+    size_t length = (uint8_t *)block + block->size - start;
+    PageKind kind = page_map.get(block);
+    if (kind == PAGE_HUGE)
+        length = (length + HUGE_PAGE_SIZE - 1) & ~(size_t)(HUGE_PAGE_SIZE - 1);
+    page_map.set(block, block->size, PAGE_NONE);
+    length = (length + (1 << PAGE_SHIFT) - 1) & ~(size_t)((1 << PAGE_SHIFT) - 1);
+    if (USE_MMAP_CACHE && kind == PAGE_MMAP && _mmapCachePut(start, length))
+        return 0;
+    return _munmap(start, length);
+}
+
+/**
+ * Slab layer for requests smaller than SPLIT_SIZE (only when USE_SLABS is set).
+ * Small objects have no metaData at all. They live in SLAB_SIZE slabs carved
+ * from one reserved region, so sfree recognizes them by the page map and finds
+ * their slab by masking the pointer. Each slab serves a single size class
+ * (multiples of 8) and keeps its free objects in an intrusive list.
+ */
+struct Slab
+{
+    Slab *next;
+    Slab *prev;
+    void *free_objects;
+    size_t object_size;
+    int used;
+    int capacity;
+};
+
+uint8_t *slab_region = nullptr; // reserved lazily, SLAB_REGION_SIZE bytes
+uint8_t *slab_region_top = nullptr; // next slab that was never used
+Slab *partial_slabs[SLAB_CLASSES]; // slabs with at least one free object
+Slab *empty_slabs = nullptr;       // may be reused by any size class
+size_t slabs_used = 0;
+size_t slab_objects = 0;
+size_t slab_bytes = 0;
+
+bool _isSlabObject(void *p)
+{
+    return page_map.get(p) == PAGE_SLAB;
+}
+
+Slab *_slabOf(void *p)
+{
+    return (Slab *)((uintptr_t)p & ~(uintptr_t)(SLAB_SIZE - 1));
+}
+
+void _slabListPush(Slab **list, Slab *slab)
+{
+    slab->prev = nullptr;
+    slab->next = *list;
+    if (*list)
+        (*list)->prev = slab;
+    *list = slab;
+}
+
+void _slabListErase(Slab **list, Slab *slab)
+{
+    if (slab->prev)
+        slab->prev->next = slab->next;
+    else
+        *list = slab->next;
+    if (slab->next)
+        slab->next->prev = slab->prev;
+}
+
+/**
+ * @brief takes an empty slab (a recycled one, or a new one from the region)
+ * and threads all of its objects on its free list
+ *
+ * @return Slab* nullptr if the region is exhausted or can't be reserved
+ */
+Slab *_newSlab(size_t object_size)
+{
+    Slab *slab = empty_slabs;
+    if (slab)
+    {
+        _slabListErase(&empty_slabs, slab);
+    }
+    else
+    {
+        if (!slab_region)
+        {
+            void *ptr = _mmap(NULL, SLAB_REGION_SIZE, PROT_READ | PROT_WRITE,
+                             MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+            if (ptr == MAP_FAILED)
+            {
+                return nullptr;
+            }
+            slab_region = (uint8_t *)ptr;
+            slab_region_top = slab_region;
+        }
+        if (slab_region_top == slab_region + SLAB_REGION_SIZE)
+            return nullptr;
+        if (!page_map.set(slab_region_top, SLAB_SIZE, PAGE_SLAB))
+            return nullptr;
+        slab = (Slab *)slab_region_top;
+        slab_region_top += SLAB_SIZE;
+    }
+    slab->object_size = object_size;
+    slab->used = 0;
+    slab->capacity = (SLAB_SIZE - sizeof(Slab)) / object_size;
+    slab->free_objects = nullptr;
+    uint8_t *objects = (uint8_t *)slab + sizeof(Slab);
+    for (int i = slab->capacity - 1; i >= 0; i--)
+    {
+        void **object = (void **)(objects + i * object_size);
+        *object = slab->free_objects;
+        slab->free_objects = object;
+    }
+    slabs_used++;
+    return slab;
+}
+
+/**
+ * @brief allocates a small object from a slab of its size class
+ *
+ * @param size requested size, smaller than SPLIT_SIZE
+ * @return void* the object. nullptr if no slab could be found
+ */
+void *_slabAlloc(size_t size)
+{
+    int size_class = (size + 7) / 8 - 1;
+    Slab *slab = partial_slabs[size_class];
+    if (!slab)
+    {
+        slab = _newSlab((size_class + 1) * 8);
+        if (!slab)
+            return nullptr;
+        _slabListPush(&partial_slabs[size_class], slab);
+    }
+    void **object = (void **)slab->free_objects;
+    slab->free_objects = *object;
+    slab->used++;
+    if (slab->used == slab->capacity)
+        _slabListErase(&partial_slabs[size_class], slab);
+
+    // stats:
+    slab_objects++;
+    slab_bytes += slab->object_size;
+    return object;
+}
+
+void _slabFree(void *p)
+{
+    Slab *slab = _slabOf(p);
+    int size_class = slab->object_size / 8 - 1;
+    if (slab->used == slab->capacity)
+        _slabListPush(&partial_slabs[size_class], slab);
+    *(void **)p = slab->free_objects;
+    slab->free_objects = p;
+    slab->used--;
+
+    // stats:
+    slab_objects--;
+    slab_bytes -= slab->object_size;
+
+    if (slab->used == 0)
+    {
+        _slabListErase(&partial_slabs[size_class], slab);
+        _slabListPush(&empty_slabs, slab);
+        slabs_used--;
+    }
+}
+
+/**
+ * @brief gives the memory above a free wilderness back to the OS. the heap only
+ * shrinks by whole pages, and only if nothing else moved its top since
+ *
+ * @param pad payload bytes to leave in the wilderness
+ * @return size_t bytes given back
+ */
+size_t Arena::trim(size_t pad)
+{
+    if (!wilderness || !wilderness->is_free || pad > (size_t)max_size)
+        return 0;
+    uint8_t *top = (uint8_t *)wilderness + wilderness->size;
+    if (extendHeap(0) != top)
+        return 0;
+    uint8_t *new_top = _pageOf((uint8_t *)wilderness + padd_size(pad) + (1 << PAGE_SHIFT) - 1);
+    if (new_top >= top)
+        return 0;
+    size_t released = top - new_top;
+    if (extendHeap(-(intptr_t)released) == (void *)(-1))
+        return 0;
+    if (USE_PURGE)
+        _untrackPages(wilderness);
+    wilderness->size -= released;
+    wilderness->setTip();
+    if (USE_PURGE)
+        _trackPages(wilderness);
+
+    // stats:
+    allocated_bytes -= released;
+    free_bytes -= released;
+    return released;
+}
+
+void Arena::_trimIfLarge()
+{
+    if (wilderness->is_free && wilderness->size - meta_size > trim_threshold.load(std::memory_order_relaxed))
+        trim(0);
+}
+
+/**
+ * @brief the decay thread. every step of the decay time it decays the pages of
+ * every arena, taking the arena's lock for one block at a time
+ */
+void *_decayThread(void *)
+{
+    while (true)
+    {
+        size_t decay_ms = purge_decay_ms.load(std::memory_order_relaxed);
+        usleep(1000 * (decay_ms ? std::max(decay_ms / PURGE_DECAY_STEPS, (size_t)1) : 1000));
+        decay_ms = purge_decay_ms.load(std::memory_order_relaxed);
+        uint64_t now = _nowMs();
+        for (Arena *arena = arenas; arena < arenas + num_arenas; arena++)
+        {
+            bool more = true;
+            while (more)
+            {
+                ArenaLock lock(arena);
+                more = arena->decayStep(now, decay_ms);
+            }
+        }
+    }
+    return nullptr;
+}
+
+void _startDecayThread()
+{
+    // signals are for the program's threads
+    sigset_t all, old;
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &old);
+    pthread_t thread;
+    if (pthread_create(&thread, nullptr, _decayThread, nullptr) == 0)
+    {
+        pthread_detach(thread);
+        decay_thread.store(true);
+    }
+    pthread_sigmask(SIG_SETMASK, &old, nullptr);
+}
+
+/**
+ * @brief called for every block that becomes free. the pages of a block of
+ * PURGE_MIN_SIZE bytes or more are purged right away, or wait in the dirty
+ * decay list if there is a decay time (and a thread to decay them)
+ */
+void Arena::_trackPages(MallocMetadata *block)
+{
+    uint8_t *start;
+    if (block->pages != PAGES_DIRTY || block->size < PURGE_MIN_SIZE)
+        return;
+    size_t length = _purgeRange(block, &start);
+    if (length == 0)
+        return;
+    size_t decay_ms = purge_decay_ms.load(std::memory_order_relaxed);
+    if (decay_ms)
+        pthread_once(&decay_once, _startDecayThread);
+    if (!decay_ms || !decay_thread.load(std::memory_order_relaxed))
+    {
+        _purgePages(block, PAGES_CLEAN);
+        return;
+    }
+    dirty_pages.advance(_nowMs(), decay_ms);
+    dirty_pages.push(block, length);
+    block->pages = PAGES_DECAYING;
+}
+
+/**
+ * @brief takes a free block off its decay list, and forgets it was purged.
+ * called before the block is used or resized
+ *
+ * @param decayed it leaves the list to be purged
+ */
+void Arena::_untrackPages(MallocMetadata *block, bool decayed)
+{
+    if (block->pages == PAGES_DIRTY)
+        return;
+    uint8_t *start;
+    size_t length = _purgeRange(block, &start);
+    if (block->pages == PAGES_DECAYING)
+        dirty_pages.erase(block, length, decayed);
+    else if (block->pages == PAGES_MUZZY)
+        muzzy_pages.erase(block, length, decayed);
+    else if (block->pages == PAGES_CLEAN)
+        purged_bytes -= length; // stats:
+    block->pages = PAGES_DIRTY;
+}
+
+/**
+ * @brief gives the pages of a large free block to the OS. a muzzy block joins
+ * the muzzy decay list. kernels without MADV_FREE make it clean right away
+ *
+ * @param state PAGES_MUZZY or PAGES_CLEAN
+ */
+void Arena::_purgePages(MallocMetadata *block, PageState state)
+{
+    uint8_t *start;
+    size_t length = _purgeRange(block, &start);
+    _untrackPages(block, true);
+    if (state == PAGES_MUZZY && madvise(start, length, MADV_FREE) != 0)
+        state = PAGES_CLEAN;
+    if (state == PAGES_CLEAN && madvise(start, length, MADV_DONTNEED) != 0)
+        return;
+    block->pages = state;
+    if (state == PAGES_MUZZY)
+        muzzy_pages.push(block, length);
+    else
+        purged_bytes += length; // stats:
+}
+
+/**
+ * @brief decays the oldest block that overstayed the decay curve by one state:
+ * dirty pages become muzzy and muzzy pages become clean
+ *
+ * @param now in ms, of CLOCK_MONOTONIC
+ * @return true if a block was decayed. false when the arena is within the curve
+ */
+bool Arena::decayStep(uint64_t now, size_t decay_ms)
+{
+    dirty_pages.advance(now, decay_ms);
+    muzzy_pages.advance(now, decay_ms);
+    if (dirty_pages.bytes > dirty_pages.limit())
+    {
+        _purgePages(dirty_pages.getOldest(), PAGES_MUZZY);
+        return true;
+    }
+    if (muzzy_pages.bytes > muzzy_pages.limit())
+    {
+        _purgePages(muzzy_pages.getOldest(), PAGES_CLEAN);
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief makes the pages of every block in the decay lists clean now
+ *
+ * @return size_t bytes purged
+ */
+size_t Arena::purgeAll()
+{
+    size_t before = purged_bytes;
+    while (dirty_pages.getOldest())
+        _purgePages(dirty_pages.getOldest(), PAGES_CLEAN);
+    while (muzzy_pages.getOldest())
+        _purgePages(muzzy_pages.getOldest(), PAGES_CLEAN);
+    return purged_bytes - before;
+}
+
+/**
+ * @brief mmaps a block of its own. huge pages are tried first if asked for,
+ * and regular pages are used when the huge page pool is exhausted
+ *
+ * @param size whole block, metaData and padding included
+ * @param huge back the block by huge pages. the mapping is rounded up to HUGE_PAGE_SIZE
+ * @param reused if not nullptr, set to whether the mapping came from the mmap cache, so it isn't zeroed
+ * @return MallocMetadata* of the new block. nullptr on failure
+ */
+MallocMetadata *Arena::_mmapMalloc(size_t size, bool huge, bool *reused)
+{
+    void *ptr = MAP_FAILED;
+    if (reused)
+        *reused = false;
+    if (huge)
+    {
+        size_t length = (size + HUGE_PAGE_SIZE - 1) & ~(size_t)(HUGE_PAGE_SIZE - 1);
+        ptr = _mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (ptr != MAP_FAILED && !page_map.set(ptr, size, PAGE_HUGE))
+        {
+            _munmap(ptr, length);
+            return nullptr;
+        }
+    }
+    if (ptr == MAP_FAILED)
+    {
+        void *cached = USE_MMAP_CACHE ? _mmapCacheGet(size) : nullptr;
+        if (cached && reused)
+            *reused = true;
+        ptr = cached ? cached : _mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (ptr == MAP_FAILED)
+        {
+            return nullptr;
+        }
+        if (!page_map.set(ptr, size, PAGE_MMAP))
+        {
+            _munmap(ptr, size);
+            return nullptr;
+        }
+    }
+    MallocMetadata *new_mmap = (MallocMetadata *)(ptr);
+    *new_mmap = MallocMetadata(size, id);
+    new_mmap->is_free = false;
+
+    // stats:
+    updateMmapAdd(new_mmap);
+    return new_mmap;
+}
+
+/**
+ * @brief resizes an mmapped block (of regular pages) with mremap. shrinking
+ * gives the tail back in place, growing tries in place and otherwise moves the
+ * block into a new mapping.
+ * pages leave the page map before they are given back: right after mremap
+ * another arena may map them and register them as its own
+ *
+ * @param size new size of the whole block, metaData and padding included
+ * @return MallocMetadata* of the resized block. nullptr on failure, and then block is untouched
+ */
+MallocMetadata *Arena::_mremapBlock(MallocMetadata *block, size_t size)
+{
+    // aligned blocks may start in the middle of their first page
+    uint8_t *start = _pageOf(block);
+    size_t head = (uint8_t *)block - start;
+    size_t old_size = block->size;
+    uint8_t *old_end = (uint8_t *)block + old_size;
+    MallocMetadata *remapped = block;
+    if (size < old_size)
+    {
+        // the pages past the new end are given back
+        uint8_t *tail = _pageOf((uint8_t *)block + size + (1 << PAGE_SHIFT) - 1);
+        size_t tail_length = (tail < old_end) ? old_end - tail : 0;
+        page_map.set(tail, tail_length, PAGE_NONE);
+        if (mremap(start, head + old_size, head + size, 0) == MAP_FAILED)
+        {
+            page_map.set(tail, tail_length, PAGE_MMAP);
+            return nullptr;
+        }
+    }
+    else if (mremap(start, head + old_size, head + size, 0) != MAP_FAILED)
+    {
+        // grew in place, the new pages are ours until they are registered
+        if (!page_map.set(old_end, size - old_size, PAGE_MMAP))
+        {
+            page_map.set(old_end, size - old_size, PAGE_NONE);
+            mremap(start, head + size, head + old_size, 0);
+            page_map.set(block, old_size, PAGE_MMAP);
+            return nullptr;
+        }
+    }
+    else
+    {
+        // move into a mapping registered beforehand, so nothing can fail once the old pages are gone
+        uint8_t *dest = (uint8_t *)_mmap(NULL, head + size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (dest == MAP_FAILED)
+            return nullptr;
+        remapped = (MallocMetadata *)(dest + head);
+        if (!page_map.set(remapped, size, PAGE_MMAP))
+        {
+            page_map.set(remapped, size, PAGE_NONE);
+            _munmap(dest, head + size);
+            return nullptr;
+        }
+        page_map.set(block, old_size, PAGE_NONE);
+        if (mremap(start, head + old_size, head + size, MREMAP_MAYMOVE | MREMAP_FIXED, dest) == MAP_FAILED)
+        {
+            page_map.set(block, old_size, PAGE_MMAP);
+            page_map.set(remapped, size, PAGE_NONE);
+            _munmap(dest, head + size);
+            return nullptr;
+        }
+    }
+    remapped->size = size;
+
+    // stats:
+    allocated_bytes += size;
+    allocated_bytes -= old_size;
+    mmap_bytes += size;
+    mmap_bytes -= old_size;
+    return remapped;
+}
+
+/**
+ * @brief extends the heap by at least "addition" bytes. with HEAP_GROWTH_GRANULE
+ * its new top is rounded up to a multiple of the granule, so a run of growing
+ * allocations doesn't make a syscall each. the wilderness must be the top block
+ *
+ * @return size_t bytes the heap grew by. 0 on failure
+ */
+size_t Arena::_growHeap(size_t addition)
+{
+    if (HEAP_GROWTH_GRANULE)
+    {
+        uintptr_t top = (uintptr_t)wilderness + wilderness->size;
+        size_t rounded = ((top + addition + HEAP_GROWTH_GRANULE - 1) & ~(uintptr_t)(HEAP_GROWTH_GRANULE - 1)) - top;
+        // a heap that can't take the whole granule grows by what is missing
+        if (rounded > addition && _canExtend(rounded) && extendHeap(rounded) != (void *)(-1))
+            return rounded;
+    }
+    return extendHeap(addition) == (void *)(-1) ? 0 : addition;
+}
+
+/**
+ * @brief the used wilderness keeps "size" bytes, and what the heap grew by
+ * beyond them becomes a new free wilderness
+ *
+ * @return void* payload of the used block
+ */
+void *Arena::_splitWilderness(size_t size)
+{
+    MallocMetadata *block = wilderness;
+    int remaining = block->size - size;
+    if (isSplitable(remaining))
+    {
+        wilderness = _split(block, remaining);
+        addFreeBlock(wilderness);
+    }
+    return PAYLOAD(block);
+}
+
+/**
+ * @brief allocates a block on the heap, or mmaps it if it's large
+ *
+ * @param purged if not nullptr, set to whether the block was a purged free block.
+ * the whole pages _purgeRange gives for it (below the old top of the heap) read as zero
+ * @return void* payload. nullptr on failure
+ */
+void *Arena::_heapMalloc(size_t size, bool *purged)
+{
+    if (size == 0 || size > max_size)
+    {
+        return nullptr;
+    }
+
+    if (!initialized)
+        initialize();
+
+    if (purged)
+        *purged = false;
+
+    // metaData size + 8-multiple padding
+
+    bool huge = USE_HUGE_PAGES && size >= SMALLOC_HUGE_PAGE_THRESHOLD;
+    size = padd_size(size);
+    if (_isLarge(size)) // mmap size
+    {
+        MallocMetadata *new_mmap = _mmapMalloc(size, huge);
+        return new_mmap ? PAYLOAD(new_mmap) : nullptr;
+    }
+
+    if (!wilderness)
+    {
+        if (!_createWilderness())
+            return nullptr;
+    }
+
+    if (USE_FASTBINS)
+    {
+        MallocMetadata *fast_block = _fastMalloc(size);
+        if (fast_block)
+            return PAYLOAD(fast_block);
+    }
+
+    // look for best free block in free_list
+    MallocMetadata *block = _findBestFit(size);
+    if (USE_FASTBINS && !block && fast_bytes)
+    {
+        consolidate();
+        block = _findBestFit(size);
+    }
+
+    if (block != nullptr) // we found a block
+    {
+        if (purged)
+            *purged = block->pages == PAGES_CLEAN;
+        eraseFreeBlock(block);
+        int remaining = block->size - size;
+        if (isSplitable(remaining)) // to split or not to split?
+        {
+            MallocMetadata *new_block = _split(block, remaining);
+            // list update:
+            addFreeBlock(new_block);
+        }
+        return PAYLOAD(block);
+    }
+    // reaching here means we couldn't find a large enough spot in the free_list
+    // let's try wilderness instead:
+    if (!_roomForWilderness(size))
+        return nullptr;
+    if (wilderness->is_free)
+    {
+        if (purged)
+            *purged = wilderness->pages == PAGES_CLEAN;
+        if (USE_PURGE)
+            _untrackPages(wilderness);
+        if (wilderness->size >= size)
+        {
+            if (isSplitable(wilderness->size - size))
+            {
+                eraseFreeBlock(wilderness);
+                MallocMetadata *old_wilderness = wilderness;
+                wilderness = _split(wilderness, wilderness->size - size);
+                addFreeBlock(wilderness);
+                return PAYLOAD(old_wilderness);
+            }
+            else
+            {
+                // no splitting - no need to update the Tips or size
+                wilderness->is_free = false;
+
+                // stats:
+                free_bytes -= (wilderness->size - meta_size);
+                return PAYLOAD(wilderness);
+            }
+        }
+        else
+        {
+            // need to sbrk()
+            size_t addition = _growHeap(size - wilderness->size);
+            if (!addition)
+            {
+                return nullptr;
+            }
+            wilderness->size += addition;
+            wilderness->is_free = false;
+
+            // tip update:
+            wilderness->setTip();
+
+            // stats:
+            free_bytes -= (wilderness->size - addition - meta_size);
+            allocated_bytes += addition;
+            return _splitWilderness(size);
+        }
+    }
+    else // need to assign new wilderness and use it
+    {
+        size_t grown = _growHeap(size);
+        if (!grown)
+        {
+            return nullptr;
+        }
+        MallocMetadata *new_wilderness = (MallocMetadata *)((uint8_t *)wilderness + wilderness->size);
+        *new_wilderness = MallocMetadata(grown, id);
+        new_wilderness->is_free = false;
+        new_wilderness->prev_free = wilderness->is_free;
+
+        // create new tip:
+        new_wilderness->setTip();
+
+        // update wilderness
+        wilderness = new_wilderness;
+
+        // stats:
+        allocated_blocks++;
+        allocated_bytes += (grown - meta_size);
+        meta_data_bytes += meta_size;
+    }
+    wilderness->is_free = false;
+    return _splitWilderness(size);
+}
+
+/**
+ * @brief _heapMalloc of a zeroed block. only the bytes that may be dirty are cleared:
+ * fresh mappings (not cached ones), the pages the heap grew by for this block
+ * and purged pages come zeroed from the kernel
+ */
+void *Arena::_heapCalloc(size_t size)
+{
+    if (size == 0 || size > max_size)
+    {
+        return nullptr;
+    }
+
+    if (!initialized)
+        initialize();
+    if (_isLarge(padd_size(size))) // a fresh mapping, unless it's a cached one
+    {
+        bool huge = USE_HUGE_PAGES && size >= SCALLOC_HUGE_PAGE_THRESHOLD;
+        bool reused = false;
+        MallocMetadata *new_mmap = _mmapMalloc(padd_size(size), huge, &reused);
+        if (!new_mmap)
+            return nullptr;
+        if (reused)
+            std::memset(PAYLOAD(new_mmap), 0, size);
+        return PAYLOAD(new_mmap);
+    }
+    if (!wilderness)
+    {
+        if (!_createWilderness())
+            return nullptr;
+    }
+    // _heapMalloc would consolidate the fast bins, which may trim the heap below the top taken here
+    if (USE_FASTBINS && fast_bytes && !_findBestFit(padd_size(size)))
+        consolidate();
+    // the top page may have been dirtied before the heap shrank, the pages above it are new
+    uint8_t *top = (uint8_t *)wilderness + wilderness->size;
+    uint8_t *clean = _pageOf(top + (1 << PAGE_SHIFT) - 1);
+    uint8_t *top_segment = segment;
+    size_t top_segment_size = segment_size;
+
+    bool purged = false;
+    uint8_t *p = (uint8_t *)_heapMalloc(size, &purged);
+    if (!p)
+        return p;
+    uint8_t *end = std::max(p, std::min(p + size, clean));
+    if (segment && (p < top_segment || p >= top_segment + top_segment_size))
+    {
+        // not in the segment the top was in: a new segment is all fresh, older ones may be above the top
+        end = (segment != top_segment && p >= segment && p < segment + segment_size) ? p : p + size;
+    }
+    if (purged)
+    {
+        // so are the pages that were purged while the block was free
+        uint8_t *zero_start;
+        size_t length = _purgeRange((MallocMetadata *)(p - offset), &zero_start);
+        uint8_t *zero_end = std::min(zero_start + length, _pageOf(top - sizeof(MallocTip)));
+        if (zero_start < zero_end && zero_start < end)
+        {
+            std::memset(p, 0, zero_start - p);
+            if (zero_end < end)
+                std::memset(zero_end, 0, end - zero_end);
+            return p;
+        }
+    }
+    std::memset(p, 0, end - p);
+    return p;
+}
+
+/**
+ * @brief allocates a block whose payload is aligned to "alignment".
+ * a block with room for the slack is allocated, and the slack below the aligned
+ * payload is split off as a free block, so it isn't lost
+ *
+ * @param alignment power of 2, larger than 8
+ * @return void* aligned payload. nullptr on failure
+ */
+void *Arena::_heapMemalign(size_t alignment, size_t size)
+{
+    if (size == 0 || size > max_size || alignment > (size_t)max_size)
+    {
+        return nullptr;
+    }
+
+    if (!initialized)
+        initialize();
+
+    // the leading slack is either 0 or large enough to be a block of its own
+    size_t slack = alignment + min_block_size;
+    if (_isLarge(padd_size(size) + slack))
+        return _mmapMemalign(alignment, size);
+
+    // ask for a whole padded block plus slack, so what is left after the leading split is a valid block
+    void *p = _heapMalloc(padd_size(size) - meta_size + slack);
+    if (!p)
+        return p;
+    MallocMetadata *block = (MallocMetadata *)((uint8_t *)p - offset);
+    if ((uintptr_t)p % alignment != 0)
+    {
+        uintptr_t aligned_p = ((uintptr_t)p + min_block_size + alignment - 1) & ~(alignment - 1);
+        bool was_wilderness = block == wilderness;
+        MallocMetadata *aligned = _split(block, block->size - (aligned_p - (uintptr_t)p));
+        aligned->is_free = false;
+        if (was_wilderness)
+            wilderness = aligned;
+        _updateNext(aligned);
+        // a block from the fast bins may lie right above a free one. the slack is freed as a split
+        // remainder, so it merges instead of going to a bin
+        block->is_free = true;
+        _heapFree(PAYLOAD(block));
+        block = aligned;
+    }
+
+    int remaining = block->size - padd_size(size);
+    if (isSplitable(remaining))
+    {
+        bool was_wilderness = block == wilderness;
+        MallocMetadata *rest = _split(block, remaining);
+        if (was_wilderness)
+            wilderness = rest;
+        // the tail may touch a free block above it, free it so the two merge
+        _heapFree(PAYLOAD(rest));
+    }
+    return PAYLOAD(block);
+}
+
+/**
+ * @brief mmaps a block whose payload is aligned to "alignment".
+ * alignment more bytes are mapped, and the whole pages around the block are
+ * unmapped. the metaData may then start in the middle of its first page
+ */
+void *Arena::_mmapMemalign(size_t alignment, size_t size)
+{
+    size_t block_size = padd_size(size);
+    size_t length = block_size + alignment;
+    void *ptr = _mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ptr == MAP_FAILED)
+    {
+        return nullptr;
+    }
+    uint8_t *base = (uint8_t *)ptr;
+    uintptr_t aligned_p = ((uintptr_t)base + offset + alignment - 1) & ~(alignment - 1);
+    MallocMetadata *block = (MallocMetadata *)(aligned_p - offset);
+    uint8_t *start = _pageOf(block);
+    uint8_t *end = _pageOf((uint8_t *)block + block_size - 1) + (1 << PAGE_SHIFT);
+    if (start > base)
+        _munmap(base, start - base);
+    if (base + length > end)
+        _munmap(end, base + length - end);
+    if (!page_map.set(block, block_size, PAGE_MMAP))
+    {
+        _munmap(start, end - start);
+        return nullptr;
+    }
+    *block = MallocMetadata(block_size, id);
+    block->is_free = false;
+
+    // stats:
+    updateMmapAdd(block);
+    return PAYLOAD(block);
+}
+
+/**
+ * @brief splits a used block in two used blocks
+ *
+ * @param block used block, not in the free list
+ * @param size size of the first block, metaData included
+ * @return MallocMetadata* the second block
+ */
+MallocMetadata *Arena::_carve(MallocMetadata *block, size_t size)
+{
+    size_classes[_sizeClass(block->size)].splits++;
+    MallocMetadata *rest = (MallocMetadata *)((uint8_t *)block + size);
+    *rest = MallocMetadata(block->size - size, id);
+    rest->is_free = false;
+    block->size = size;
+    block->setTip();
+    rest->setTip();
+    if (block == wilderness)
+        wilderness = rest;
+
+    // stats:
+    allocated_bytes -= meta_size;
+    allocated_blocks++;
+    meta_data_bytes += meta_size;
+    return rest;
+}
+
+/**
+ * @brief cuts count blocks of the same size from the start of a used block.
+ * what remains after them is freed if it's large enough, otherwise the last
+ * block keeps it
+ *
+ * @param block used block, not in the free list, at least count * size bytes
+ * @param size size of every block, metaData and padding included
+ */
+void Arena::_carveBatch(MallocMetadata *block, size_t size, size_t count, void **out_ptrs)
+{
+    int remaining = block->size - count * size;
+    if (isSplitable(remaining))
+    {
+        bool was_wilderness = block == wilderness;
+        MallocMetadata *rest = _split(block, remaining);
+        if (was_wilderness)
+            wilderness = rest;
+        addFreeBlock(rest);
+    }
+    for (size_t i = 0; i < count - 1; i++)
+    {
+        out_ptrs[i] = PAYLOAD(block);
+        block = _carve(block, size);
+    }
+    out_ptrs[count - 1] = PAYLOAD(block);
+}
+
+/**
+ * @brief allocates count blocks of the same size at once. every free block
+ * that fits gives as many of them as it can hold, and what is still missing
+ * then comes from a single extension of the wilderness
+ *
+ * @return size_t how many blocks were allocated
+ */
+size_t Arena::_heapMallocBatch(size_t size, size_t count, void **out_ptrs)
+{
+    if (size == 0 || size > max_size)
+        return 0;
+    if (!initialized)
+        initialize();
+
+    size_t done = 0;
+    if (_isLarge(padd_size(size)))
+    {
+        while (done < count && (out_ptrs[done] = _heapMalloc(size)))
+            done++;
+        return done;
+    }
+    if (!wilderness && !_createWilderness())
+        return 0;
+    size = padd_size(size);
+
+    while (done < count)
+    {
+        if (USE_FASTBINS)
+        {
+            MallocMetadata *fast_block = _fastMalloc(size);
+            if (fast_block)
+            {
+                out_ptrs[done++] = PAYLOAD(fast_block);
+                continue;
+            }
+        }
+        MallocMetadata *block = _findBestFit(size);
+        if (USE_FASTBINS && !block && fast_bytes)
+        {
+            consolidate();
+            block = _findBestFit(size);
+        }
+        if (!block)
+            break;
+        eraseFreeBlock(block);
+        size_t n = std::min(count - done, block->size / size);
+        _carveBatch(block, size, n, out_ptrs + done);
+        done += n;
+    }
+    if (done == count)
+        return done;
+
+    // the rest in one extension of the wilderness
+    size_t total = (count - done) * size;
+    if (!_roomForWilderness(total))
+        return done;
+    MallocMetadata *block;
+    if (wilderness->is_free)
+    {
+        if (wilderness->size < total)
+        {
+            size_t addition = _growHeap(total - wilderness->size);
+            if (!addition)
+                return done;
+            if (USE_PURGE)
+                _untrackPages(wilderness);
+            wilderness->size += addition;
+            allocated_bytes += addition;
+            free_bytes += addition;
+        }
+        eraseFreeBlock(wilderness);
+        block = wilderness;
+    }
+    else
+    {
+        size_t grown = _growHeap(total);
+        if (!grown)
+            return done;
+        block = (MallocMetadata *)((uint8_t *)wilderness + wilderness->size);
+        *block = MallocMetadata(grown, id);
+        block->is_free = false;
+        block->setTip();
+        wilderness = block;
+
+        // stats:
+        allocated_blocks++;
+        allocated_bytes += grown - meta_size;
+        meta_data_bytes += meta_size;
+    }
+    size_t n = std::min(count - done, block->size / size);
+    _carveBatch(block, size, n, out_ptrs + done);
+    return done + n;
+}
+
+/**
+ * @brief frees blocks of this arena, sorted by address. runs of adjacent
+ * blocks are merged while they are still used, and then freed as one block
+ */
+void Arena::_heapFreeBatch(void **ptrs, size_t count)
+{
+    size_t i = 0;
+    while (i < count)
+    {
+        MallocMetadata *run = (MallocMetadata *)((uint8_t *)ptrs[i++] - offset);
+        if (!_isMapped(run))
+        {
+            while (i < count && run != wilderness &&
+                   (uint8_t *)ptrs[i] - offset == (uint8_t *)run + run->size)
+            {
+                MallocMetadata *next = (MallocMetadata *)((uint8_t *)ptrs[i++] - offset);
+                bool was_wilderness = next == wilderness;
+                run = _merge(run, next);
+                if (was_wilderness)
+                    wilderness = run;
+            }
+        }
+        _heapFree(PAYLOAD(run));
+    }
+}
+
+void *Arena::_smalloc(size_t size, MallocMetadata *to_copy)
+{
+    void *p = _heapMalloc(size);
+    if (!p)
+        return p;
+    std::memmove(p, PAYLOAD(to_copy), to_copy->size - meta_size);
+    return p;
+}
+
+void Arena::_heapFree(void *p)
+{
+    if (!p)
+        return;
+
+    if (!initialized)
+        initialize();
+
+    MallocMetadata *meta = ((MallocMetadata *)((uint8_t *)p - offset));
+    // if (meta->is_free)
+    //     return;
+
+    // check and handle if mmapped
+    if (_isMapped(meta))
+    {
+        if (DYNAMIC_MMAP_THRESHOLD)
+            _raiseMmapThreshold(meta->size);
+        updateMmapRemove(meta);
+        int err = _unmapBlock(meta);
+        if (err != 0)
+        {
+            perror("unmapping failed.\n");
+            return;
+        }
+        return;
+    }
+
+    if (USE_FASTBINS && _fastFree(meta))
+        return;
+
+    // check and handle if wilderness is meta
     if (wilderness == meta)
     {
         MallocMetadata *prev = _previousToWilderness();
@@ -650,6 +2890,8 @@ void sfree(void *p)
             wilderness = _mergeFree(prev, wilderness);
         }
         addFreeBlock(wilderness);
+        if (TRIM_THRESHOLD)
+            _trimIfLarge();
         return;
     }
     // if we get here we are not freeing wilderness
@@ -692,12 +2934,18 @@ void sfree(void *p)
             // allocated_blocks--;
             eraseFreeBlock(next);
             meta = _mergeFree(meta, next);
+            if (next == wilderness)
+            {
+                wilderness = meta;
+            }
         }
     }
     addFreeBlock(meta);
+    if (TRIM_THRESHOLD && meta == wilderness)
+        _trimIfLarge();
 }
 
-void *srealloc(void *oldp, size_t size)
+void *Arena::_heapRealloc(void *oldp, size_t size)
 {
     size_t og_size = size;
     if (size == 0 || size > max_size)
@@ -710,34 +2958,36 @@ void *srealloc(void *oldp, size_t size)
 
     if (oldp == nullptr)
     {
-        return smalloc(size);
+        return _heapMalloc(size);
     }
 
     MallocMetadata *meta = (MallocMetadata *)((uint8_t *)oldp - offset);
-    if (meta->size > LARGE_MEM) // mmap allocation
+    if (_isMapped(meta)) // mmap allocation
     {
+        bool huge = USE_HUGE_PAGES && size >= SCALLOC_HUGE_PAGE_THRESHOLD;
         size = padd_size(size);
         if (size == meta->size)
             return PAYLOAD(meta);
+        if (!huge && page_map.get(meta) == PAGE_MMAP)
+        {
+            // the kernel moves the pages, no copying
+            MallocMetadata *remapped = _mremapBlock(meta, size);
+            if (remapped)
+                return PAYLOAD(remapped);
+        }
 
         // allocating new mmap:
-        void *ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_ANONYMOUS, 0, 0);
-        if (ptr == MAP_FAILED)
+        MallocMetadata *new_mmap = _mmapMalloc(size, huge);
+        if (!new_mmap)
         {
             return nullptr;
         }
-        MallocMetadata *new_mmap = (MallocMetadata *)(ptr);
-        *new_mmap = MallocMetadata(size);
-        new_mmap->is_free = false;
-        mmap_list.push(new_mmap);
-        updateMmapAdd(new_mmap);
         // moving data:
-        std::memmove(PAYLOAD(new_mmap), PAYLOAD(meta), new_mmap->size - meta_size);
+        std::memmove(PAYLOAD(new_mmap), PAYLOAD(meta), std::min(new_mmap->size, meta->size) - meta_size);
 
         // deleting current
-        mmap_list.erase(meta);
         updateMmapRemove(meta);
-        int err = munmap(meta, meta->size);
+        int err = _unmapBlock(meta);
         if (err != 0)
         {
             perror("unmapping failed.\n");
@@ -749,20 +2999,8 @@ void *srealloc(void *oldp, size_t size)
     {
         if (!wilderness)
         {
-            void *ptr = sbrk(meta_size);
-            if (ptr == (void *)(-1))
-            {
+            if (!_createWilderness())
                 return nullptr;
-            }
-            wilderness = (MallocMetadata *)ptr;
-            wilderness->size = meta_size;
-            wilderness->is_free = true;
-            wilderness->next = nullptr;
-            wilderness->prev = nullptr;
-
-            // stats:
-            allocated_blocks++; // total num of blocks
-            meta_data_bytes += meta_size;
         }
         size = padd_size(size);
 
@@ -781,6 +3019,14 @@ void *srealloc(void *oldp, size_t size)
                 // free_bytes -= (wilderness->size - meta_size);
                 return PAYLOAD(wilderness);
             }
+            if (!_canExtend(size - wilderness->size))
+            {
+                // its segment is full, the block moves on to a new one
+                void *p = _smalloc(og_size, meta);
+                if (p)
+                    _heapFree(oldp);
+                return p;
+            }
             MallocMetadata *prev = _previousToWilderness();
             if (prev != nullptr)
             { // previous is free. merging:
@@ -796,7 +3042,7 @@ void *srealloc(void *oldp, size_t size)
                     if (isSplitable(remaining))
                     { // split what remains
                         MallocMetadata *old_wilderness = wilderness;
-                        wilderness = _split(meta, remaining);
+                        wilderness = _split(wilderness, remaining);
                         addFreeBlock(wilderness);
                         return (PAYLOAD(old_wilderness));
                     }
@@ -804,29 +3050,29 @@ void *srealloc(void *oldp, size_t size)
                     return PAYLOAD(wilderness);
                 }
                 // enlarge wilderness:
-                int addition = size - wilderness->size;
-                void *ptr = sbrk(addition);
-                if (ptr == (void *)(-1))
+                size_t addition = _growHeap(size - wilderness->size);
+                if (!addition)
                 {
                     return nullptr;
                 }
                 allocated_bytes += addition;
                 wilderness->size += addition;
+                wilderness->setTip();
 
-                return PAYLOAD(wilderness);
+                return _splitWilderness(size);
             }
 
             // enlarge wilderness:
-            int addition = size - wilderness->size;
-            void *ptr = sbrk(addition);
-            if (ptr == (void *)(-1))
+            size_t addition = _growHeap(size - wilderness->size);
+            if (!addition)
             {
                 return nullptr;
             }
             allocated_bytes += addition;
             wilderness->size += addition;
+            wilderness->setTip();
 
-            return PAYLOAD(wilderness);
+            return _splitWilderness(size);
         }
         if (size <= meta->size) // Can re-use same block
         {
@@ -835,7 +3081,7 @@ void *srealloc(void *oldp, size_t size)
             if (isSplitable(remaining))
             { // split what remains
                 MallocMetadata *new_block = _split(meta, remaining);
-                sfree((PAYLOAD(new_block)));
+                _heapFree((PAYLOAD(new_block)));
             }
 
             return PAYLOAD(meta);
@@ -858,7 +3104,7 @@ void *srealloc(void *oldp, size_t size)
                 if (isSplitable(remaining))
                 { // split what remains
                     MallocMetadata *new_block = _split(meta, remaining);
-                    sfree((PAYLOAD(new_block)));
+                    _heapFree((PAYLOAD(new_block)));
                 }
 
                 return PAYLOAD(meta);
@@ -878,7 +3124,7 @@ void *srealloc(void *oldp, size_t size)
                     if (isSplitable(remaining))
                     { // split what remains
                         MallocMetadata *new_block = _split(meta, remaining);
-                        sfree((PAYLOAD(new_block)));
+                        _heapFree((PAYLOAD(new_block)));
                     }
                     return PAYLOAD(meta);
                 }
@@ -914,7 +3160,7 @@ void *srealloc(void *oldp, size_t size)
                 { // All three is more than enough and the last is not wilderness
                     // -> Merge, split and add free block.
                     MallocMetadata *new_block = _split(meta, remaining);
-                    sfree((PAYLOAD(new_block)));
+                    _heapFree((PAYLOAD(new_block)));
                 }
                 // if (remaining < 0)
                 // { // All three are not enough and the last is not wilderness
@@ -925,6 +3171,7 @@ void *srealloc(void *oldp, size_t size)
             }
             else
             {
+                wilderness = meta;
                 if (isSplitable(remaining))
                 { // All three is more than enough and the last is wilderness
                     // -> Merge, split and add free block (new wilderness).
@@ -944,97 +3191,955 @@ void *srealloc(void *oldp, size_t size)
                 meta = _mergeAndCopy(meta, next, 0);
                 wilderness = meta;
 
-                int addition = size - meta->size;
-                void *ptr = sbrk(addition);
-                if (ptr == (void *)(-1))
-                {
-                    return nullptr;
-                }
-                allocated_bytes += addition;
+                int addition = size - meta->size;
+                void *ptr = extendHeap(addition);
+                if (ptr == (void *)(-1))
+                {
+                    return nullptr;
+                }
+                allocated_bytes += addition;
+
+                wilderness->size += addition;
+                wilderness->is_free = false;
+                return PAYLOAD(wilderness);
+            } */
+        }
+
+        if (next != nullptr && prev != nullptr && next == wilderness &&
+            _canExtend(size - prev->size - meta->size - next->size))
+        {
+            // All three are not enough and the last is wilderness
+            // merge all 3:
+            eraseFreeBlock(prev);
+            eraseFreeBlock(next);
+            meta = _mergeAndCopy(prev, meta, 1);
+            meta = _mergeAndCopy(meta, next, 0);
+            wilderness = meta;
+            // enlarge wilderness:
+            size_t addition = _growHeap(size - meta->size);
+            if (!addition)
+            {
+                return nullptr;
+            }
+            allocated_bytes += addition;
+            meta->size += addition;
+            meta->setTip();
+            return _splitWilderness(size);
+        }
+
+        if (next != nullptr && next == wilderness && _canExtend(size - meta->size - next->size))
+        {
+            eraseFreeBlock(next);
+            // merge:
+            meta = _mergeAndCopy(meta, next, 0);
+            wilderness = meta;
+            size_t addition = _growHeap(size - wilderness->size);
+            if (!addition)
+            {
+                return nullptr;
+            }
+            allocated_bytes += addition;
+
+            wilderness->size += addition;
+            wilderness->setTip();
+            return _splitWilderness(size);
+        }
+
+        // If got here-
+        // free current block (and merge if possible) and smalloc
+        void *p = _smalloc(og_size, meta);
+        if (p)
+            _heapFree(oldp);
+        return p;
+    }
+}
+
+/**
+ * Thread caches.
+ * When USE_TCACHE is set, every thread keeps up to TCACHE_COUNT freed blocks
+ * of every payload size up to TCACHE_MAX_SIZE. A cached block stays used as far
+ * as its arena is concerned, so a smalloc/sfree pair of a cached size never
+ * takes a lock. Bins that are full pass blocks on to their arena, and a thread
+ * flushes its bins when it exits.
+ */
+pthread_mutex_t slab_lock = PTHREAD_MUTEX_INITIALIZER;
+std::atomic<unsigned int> next_arena(0);
+thread_local Arena *thread_arena = nullptr;
+
+class SlabLock
+{
+public:
+    SlabLock() { pthread_mutex_lock(&slab_lock); }
+    ~SlabLock() { pthread_mutex_unlock(&slab_lock); }
+};
+
+/**
+ * @brief the arena of the calling thread. binds it to one on first use
+ */
+Arena *_threadArena()
+{
+    if (!thread_arena)
+    {
+        pthread_once(&arenas_once, _setupArenas);
+        thread_arena = &arenas[next_arena++ % num_arenas];
+    }
+    return thread_arena;
+}
+
+Arena *_arenaOf(void *p)
+{
+    MallocMetadata *block = (MallocMetadata *)((uint8_t *)p - offset);
+    return &arenas[block->arena];
+}
+
+/**
+ * @brief the size of the block a payload belongs to, metaData included
+ */
+size_t _blockSize(void *p)
+{
+    return ((MallocMetadata *)((uint8_t *)p - offset))->size;
+}
+
+struct TCache
+{
+    MallocMetadata *bins[TCACHE_CLASSES];
+    int counts[TCACHE_CLASSES];
+    ~TCache();
+};
+thread_local TCache tcache;
+
+TCache::~TCache()
+{
+    for (int i = 0; i < TCACHE_CLASSES; i++)
+    {
+        while (bins[i])
+        {
+            MallocMetadata *block = bins[i];
+            bins[i] = block->next;
+            Arena *arena = &arenas[block->arena];
+            ArenaLock lock(arena);
+            arena->_statFree(block->size);
+            arena->_heapFree(PAYLOAD(block));
+        }
+        counts[i] = 0;
+    }
+}
+
+/**
+ * @brief tcache bin of a payload size
+ *
+ * @return int the bin. -1 if blocks of this size are not cached
+ */
+int _tcacheClass(size_t payload_size)
+{
+    if (payload_size == 0 || payload_size > TCACHE_MAX_SIZE || payload_size % 8 != 0)
+        return -1;
+    return payload_size / 8 - 1;
+}
+
+void *_tcacheGet(size_t size)
+{
+    if (size == 0 || size > max_size || (USE_SLABS && size < SPLIT_SIZE))
+        return nullptr;
+    int bin = _tcacheClass(padd_size(size) - meta_size);
+    if (bin < 0 || !tcache.bins[bin])
+        return nullptr;
+    MallocMetadata *block = tcache.bins[bin];
+    tcache.bins[bin] = block->next;
+    tcache.counts[bin]--;
+    return PAYLOAD(block);
+}
+
+bool _tcachePut(void *p)
+{
+    MallocMetadata *block = (MallocMetadata *)((uint8_t *)p - offset);
+    int bin = _tcacheClass(block->size - meta_size);
+    if (bin < 0 || tcache.counts[bin] == TCACHE_COUNT)
+        return false;
+    block->next = tcache.bins[bin];
+    tcache.bins[bin] = block;
+    tcache.counts[bin]++;
+    return true;
+}
+
+void *smalloc(size_t size)
+{
+    if (USE_SLABS && size > 0 && size < SPLIT_SIZE)
+    {
+        SlabLock lock;
+        void *object = _slabAlloc(size);
+        if (object)
+            return object;
+        // slab region is exhausted, fall back to the heap
+    }
+    if (USE_TCACHE)
+    {
+        void *p = _tcacheGet(size);
+        if (p)
+            return p;
+    }
+    Arena *arena = _threadArena();
+    void *p;
+    {
+        ArenaLock lock(arena);
+        if (USE_REMOTE_FREE)
+            arena->drainRemoteFrees();
+        p = arena->_heapMalloc(size);
+        if (p)
+            arena->_statAlloc(_blockSize(p));
+    }
+    if (!p && arena != &arenas[0])
+    {
+        // this arena is out of memory, fall back to arena 0
+        ArenaLock lock(&arenas[0]);
+        p = arenas[0]._heapMalloc(size);
+        if (p)
+            arenas[0]._statAlloc(_blockSize(p));
+    }
+    return p;
+}
+
+void *scalloc(size_t num, size_t size)
+{
+    size_t total_size;
+    if (__builtin_mul_overflow(num, size, &total_size))
+        return nullptr;
+    if (USE_SLABS && total_size > 0 && total_size < SPLIT_SIZE)
+    {
+        // small enough to just clear
+        void *ptr = smalloc(total_size);
+        if (ptr)
+            std::memset(ptr, 0, total_size);
+        return ptr;
+    }
+    if (USE_TCACHE)
+    {
+        void *ptr = _tcacheGet(total_size);
+        if (ptr)
+        {
+            std::memset(ptr, 0, total_size);
+            return ptr;
+        }
+    }
+    Arena *arena = _threadArena();
+    void *p;
+    {
+        ArenaLock lock(arena);
+        if (USE_REMOTE_FREE)
+            arena->drainRemoteFrees();
+        p = arena->_heapCalloc(total_size);
+        if (p)
+            arena->_statAlloc(_blockSize(p));
+    }
+    if (!p && arena != &arenas[0])
+    {
+        // this arena is out of memory, fall back to arena 0
+        ArenaLock lock(&arenas[0]);
+        p = arenas[0]._heapCalloc(total_size);
+        if (p)
+            arenas[0]._statAlloc(_blockSize(p));
+    }
+    return p;
+}
+
+/**
+ * @brief returns a block to its arena- directly, or through its remote free stack
+ */
+void _arenaFree(void *p)
+{
+    Arena *arena = _arenaOf(p);
+    if (USE_REMOTE_FREE && arena != _threadArena())
+    {
+        arena->remoteFree((MallocMetadata *)((uint8_t *)p - offset));
+        return;
+    }
+    ArenaLock lock(arena);
+    arena->_statFree(_blockSize(p));
+    arena->_heapFree(p);
+}
+
+void sfree(void *p)
+{
+    if (!p)
+        return;
+    if (USE_SLABS && _isSlabObject(p))
+    {
+        SlabLock lock;
+        _slabFree(p);
+        return;
+    }
+    if (USE_TCACHE && _tcachePut(p))
+        return;
+    _arenaFree(p);
+}
+
+/**
+ * @brief debug check of sfree_sized: size fits in the block that p points to
+ */
+bool _sizeMatches(void *p, size_t size)
+{
+    if (USE_SLABS && _isSlabObject(p))
+    {
+        SlabLock lock;
+        return size <= _slabOf(p)->object_size;
+    }
+    MallocMetadata *block = (MallocMetadata *)((uint8_t *)p - offset);
+    return size <= block->size - meta_size;
+}
+
+/**
+ * @brief sfree for callers that know the size they asked for (sized delete).
+ * the size rules the slab layer and the thread caches out without looking at
+ * the block. mmapped blocks are still told apart by the page map, since
+ * srealloc may grow a heap block past LARGE_MEM
+ *
+ * @param size the size the block was allocated (or last reallocated) with
+ */
+void sfree_sized(void *p, size_t size)
+{
+    if (!p)
+        return;
+    assert(_sizeMatches(p, size));
+    if (USE_SLABS && size < SPLIT_SIZE && _isSlabObject(p))
+    {
+        SlabLock lock;
+        _slabFree(p);
+        return;
+    }
+    if (USE_TCACHE && size <= TCACHE_MAX_SIZE && _tcachePut(p))
+        return;
+    _arenaFree(p);
+}
 
-                wilderness->size += addition;
-                wilderness->is_free = false;
-                return PAYLOAD(wilderness);
-            } */
+void *srealloc(void *oldp, size_t size)
+{
+    if (USE_SLABS && oldp && _isSlabObject(oldp) && size > 0 && size <= max_size)
+    {
+        size_t object_size;
+        {
+            SlabLock lock;
+            object_size = _slabOf(oldp)->object_size;
         }
+        if (size <= object_size)
+            return oldp;
+        void *p = smalloc(size);
+        if (!p)
+            return p;
+        std::memmove(p, oldp, object_size);
+        sfree(oldp);
+        return p;
+    }
+    Arena *arena = oldp ? _arenaOf(oldp) : _threadArena();
+    ArenaLock lock(arena);
+    size_t old_size = oldp ? _blockSize(oldp) : 0;
+    void *p = arena->_heapRealloc(oldp, size);
+    if (p)
+    {
+        // counted as a free of the old block and an allocation of the new one
+        if (oldp)
+            arena->_statFree(old_size);
+        arena->_statAlloc(_blockSize(p));
+    }
+    return p;
+}
+
+/**
+ * @brief smalloc for a payload aligned to "alignment"
+ *
+ * @param alignment power of 2
+ * @return void* nullptr if alignment isn't a power of 2, or on failure
+ */
+void *smemalign(size_t alignment, size_t size)
+{
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0)
+        return nullptr;
+    if (alignment <= 8) // every block is aligned to 8
+        return smalloc(size);
+    Arena *arena = _threadArena();
+    void *p;
+    {
+        ArenaLock lock(arena);
+        if (USE_REMOTE_FREE)
+            arena->drainRemoteFrees();
+        p = arena->_heapMemalign(alignment, size);
+        if (p)
+            arena->_statAlloc(_blockSize(p));
+    }
+    if (!p && arena != &arenas[0])
+    {
+        // this arena is out of memory, fall back to arena 0
+        ArenaLock lock(&arenas[0]);
+        p = arenas[0]._heapMemalign(alignment, size);
+        if (p)
+            arenas[0]._statAlloc(_blockSize(p));
+    }
+    return p;
+}
+
+void *saligned_alloc(size_t alignment, size_t size)
+{
+    return smemalign(alignment, size);
+}
+
+/**
+ * @brief posix_memalign: alignment must be a power of 2 and a multiple of sizeof(void *)
+ *
+ * @param memptr gets the block. nullptr if size is 0
+ * @return int 0 on success, EINVAL for a bad alignment, ENOMEM on failure
+ */
+int sposix_memalign(void **memptr, size_t alignment, size_t size)
+{
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0 || alignment % sizeof(void *) != 0)
+        return EINVAL;
+    if (size == 0)
+    {
+        *memptr = nullptr;
+        return 0;
+    }
+    void *p = smemalign(alignment, size);
+    if (!p)
+        return ENOMEM;
+    *memptr = p;
+    return 0;
+}
+
+#if OVERRIDE_NEW
+void *operator new(size_t size)
+{
+    void *p = smalloc(size ? size : 1);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+void *operator new(size_t size, const std::nothrow_t &) noexcept
+{
+    return smalloc(size ? size : 1);
+}
+void *operator new[](size_t size, const std::nothrow_t &) noexcept
+{
+    return smalloc(size ? size : 1);
+}
+void operator delete(void *p) noexcept
+{
+    sfree(p);
+}
+void operator delete[](void *p) noexcept
+{
+    sfree(p);
+}
+void operator delete(void *p, size_t size) noexcept
+{
+    sfree_sized(p, size);
+}
+void operator delete[](void *p, size_t size) noexcept
+{
+    sfree_sized(p, size);
+}
+#endif
+
+/**
+ * @brief allocates count blocks of the same size, under a single lock
+ *
+ * @param out_ptrs gets the blocks
+ * @return size_t how many were allocated. less than count if memory ran out
+ */
+size_t smalloc_batch(size_t size, size_t count, void **out_ptrs)
+{
+    if (size == 0 || size > max_size)
+        return 0;
+    size_t done = 0;
+    if (USE_SLABS && size < SPLIT_SIZE)
+    {
+        // slab objects are cheap one by one
+        while (done < count && (out_ptrs[done] = smalloc(size)))
+            done++;
+        return done;
+    }
+    Arena *arena = _threadArena();
+    {
+        ArenaLock lock(arena);
+        if (USE_REMOTE_FREE)
+            arena->drainRemoteFrees();
+        done = arena->_heapMallocBatch(size, count, out_ptrs);
+        for (size_t i = 0; i < done; i++)
+            arena->_statAlloc(_blockSize(out_ptrs[i]));
+    }
+    if (done < count && arena != &arenas[0])
+    {
+        // this arena is out of memory, fall back to arena 0
+        ArenaLock lock(&arenas[0]);
+        size_t more = arenas[0]._heapMallocBatch(size, count - done, out_ptrs + done);
+        for (size_t i = done; i < done + more; i++)
+            arenas[0]._statAlloc(_blockSize(out_ptrs[i]));
+        done += more;
+    }
+    return done;
+}
 
-        if (next != nullptr && prev != nullptr && next == wilderness)
+/**
+ * @brief frees count blocks. ptrs is sorted by address in place, so adjacent
+ * blocks are merged in one pass, and every arena is locked once per run of
+ * its blocks
+ */
+void sfree_batch(void **ptrs, size_t count)
+{
+    std::sort(ptrs, ptrs + count);
+    size_t i = 0;
+    while (i < count)
+    {
+        void *p = ptrs[i];
+        if (!p)
         {
-            // All three are not enough and the last is wilderness
-            // merge all 3:
-            eraseFreeBlock(prev);
-            eraseFreeBlock(next);
-            meta = _mergeAndCopy(prev, meta, 1);
-            meta = _mergeAndCopy(meta, next, 0);
-            int remaining = meta->size - size;
-            // enlarge wilderness:
-            int addition = -remaining;
-            void *ptr = sbrk(addition);
-            if (ptr == (void *)(-1))
-            {
-                return nullptr;
-            }
-            allocated_bytes += addition;
-            meta->size += addition;
-            wilderness = meta;
-            return PAYLOAD(meta);
+            i++;
+            continue;
         }
-
-        if (next != nullptr && next == wilderness)
+        if (USE_SLABS && _isSlabObject(p))
         {
-            eraseFreeBlock(next);
-            // merge:
-            meta = _mergeAndCopy(meta, next, 0);
-            wilderness = meta;
-            int addition = size - wilderness->size;
-            void *ptr = sbrk(addition);
-            if (ptr == (void *)(-1))
+            SlabLock lock;
+            _slabFree(p);
+            i++;
+            continue;
+        }
+        Arena *arena = _arenaOf(p);
+        size_t end = i + 1;
+        while (end < count && !(USE_SLABS && _isSlabObject(ptrs[end])) && _arenaOf(ptrs[end]) == arena)
+            end++;
+        if (USE_REMOTE_FREE && arena != _threadArena())
+        {
+            for (; i < end; i++)
             {
-                return nullptr;
+                arena->remoteFree((MallocMetadata *)((uint8_t *)ptrs[i] - offset));
             }
-            allocated_bytes += addition;
-
-            wilderness->size += addition;
-            return PAYLOAD(wilderness);
+            continue;
         }
+        ArenaLock lock(arena);
+        for (size_t j = i; j < end; j++)
+            arena->_statFree(_blockSize(ptrs[j]));
+        arena->_heapFreeBatch(ptrs + i, end - i);
+        i = end;
+    }
+}
 
-        // If got here-
-        // free current block (and merge if possible) and smalloc
-        void *p = _smalloc(og_size, meta);
-        sfree(oldp);
-        return p;
+/**
+ * @brief the sbrk arena is initialized by the statistics functions as well,
+ * so the program break is aligned before the first allocation
+ */
+Arena *_mainArena()
+{
+    pthread_once(&arenas_once, _setupArenas);
+    ArenaLock lock(&arenas[0]);
+    arenas[0].initialize();
+    return arenas;
+}
+
+/**
+ * @brief gives the free memory at the top of every heap back to the OS, like malloc_trim
+ *
+ * @param pad payload bytes to leave free at the top of every heap
+ * @return int 1 if any memory was given back, 0 otherwise
+ */
+int strim(size_t pad)
+{
+    size_t released = 0;
+    for (Arena *arena = _mainArena(); arena < arenas + num_arenas; arena++)
+    {
+        ArenaLock lock(arena);
+        if (USE_REMOTE_FREE)
+            arena->drainRemoteFrees();
+        if (USE_FASTBINS)
+            arena->consolidate();
+        released += arena->trim(pad);
+    }
+    return released > 0;
+}
+
+/**
+ * @brief purges the pages that wait in the decay lists of every heap now,
+ * without waiting for the decay thread
+ *
+ * @return int 1 if any memory was given back, 0 otherwise
+ */
+int spurge()
+{
+    size_t purged = 0;
+    for (Arena *arena = _mainArena(); arena < arenas + num_arenas; arena++)
+    {
+        ArenaLock lock(arena);
+        if (USE_REMOTE_FREE)
+            arena->drainRemoteFrees();
+        if (USE_FASTBINS)
+            arena->consolidate();
+        purged += arena->purgeAll();
     }
+    return purged > 0;
+}
+
+/**
+ * @brief sets the time free pages take to decay (USE_PURGE)
+ *
+ * @param decay_ms in ms. 0 purges the pages of large blocks in sfree, and the
+ * pages that are still decaying right away
+ */
+void sset_purge_decay(size_t decay_ms)
+{
+    purge_decay_ms.store(decay_ms, std::memory_order_relaxed);
+    if (decay_ms == 0)
+        spurge();
 }
 
 size_t _num_free_blocks()
 {
-    initialize();
-    if (!wilderness)
-        return 0;
-    return free_list.getSize() + wilderness->is_free;
+    size_t sum = 0;
+    for (Arena *arena = _mainArena(); arena < arenas + num_arenas; arena++)
+    {
+        ArenaLock lock(arena);
+        if (USE_REMOTE_FREE)
+            arena->drainRemoteFrees();
+        if (arena->wilderness)
+            sum += arena->free_list.getSize() + arena->wilderness->is_free;
+    }
+    return sum;
 }
 size_t _num_free_bytes()
 {
-    initialize();
-    return free_bytes;
+    size_t sum = 0;
+    for (Arena *arena = _mainArena(); arena < arenas + num_arenas; arena++)
+    {
+        ArenaLock lock(arena);
+        if (USE_REMOTE_FREE)
+            arena->drainRemoteFrees();
+        sum += arena->free_bytes;
+    }
+    return sum;
 }
 size_t _num_allocated_blocks()
 {
-    initialize();
-    return allocated_blocks;
+    size_t sum = 0;
+    for (Arena *arena = _mainArena(); arena < arenas + num_arenas; arena++)
+    {
+        ArenaLock lock(arena);
+        if (USE_REMOTE_FREE)
+            arena->drainRemoteFrees();
+        sum += arena->allocated_blocks;
+    }
+    return sum;
 }
 size_t _num_allocated_bytes()
 {
-    initialize();
-    return allocated_bytes;
+    size_t sum = 0;
+    for (Arena *arena = _mainArena(); arena < arenas + num_arenas; arena++)
+    {
+        ArenaLock lock(arena);
+        if (USE_REMOTE_FREE)
+            arena->drainRemoteFrees();
+        sum += arena->allocated_bytes;
+    }
+    return sum;
 }
 size_t _size_meta_data()
 {
-    initialize();
+    _mainArena();
     return meta_size;
 }
 size_t _num_meta_data_bytes()
 {
-    initialize();
     return _size_meta_data() * _num_allocated_blocks();
 }
+/**
+ * @brief the current mmap threshold: whole block size, metaData included
+ */
+size_t _mmap_threshold()
+{
+    return mmap_threshold.load(std::memory_order_relaxed);
+}
+/**
+ * @brief bytes of free blocks that were given back to the OS (USE_PURGE)
+ */
+size_t _num_purged_bytes()
+{
+    size_t sum = 0;
+    for (Arena *arena = _mainArena(); arena < arenas + num_arenas; arena++)
+    {
+        ArenaLock lock(arena);
+        if (USE_REMOTE_FREE)
+            arena->drainRemoteFrees();
+        sum += arena->purged_bytes;
+    }
+    return sum;
+}
+/**
+ * @brief bytes of free blocks that wait in the dirty decay list
+ */
+size_t _num_dirty_bytes()
+{
+    size_t sum = 0;
+    for (Arena *arena = _mainArena(); arena < arenas + num_arenas; arena++)
+    {
+        ArenaLock lock(arena);
+        if (USE_REMOTE_FREE)
+            arena->drainRemoteFrees();
+        sum += arena->dirty_pages.bytes;
+    }
+    return sum;
+}
+/**
+ * @brief bytes of free blocks that were given to the OS with MADV_FREE, and wait in the muzzy decay list
+ */
+size_t _num_muzzy_bytes()
+{
+    size_t sum = 0;
+    for (Arena *arena = _mainArena(); arena < arenas + num_arenas; arena++)
+    {
+        ArenaLock lock(arena);
+        if (USE_REMOTE_FREE)
+            arena->drainRemoteFrees();
+        sum += arena->muzzy_pages.bytes;
+    }
+    return sum;
+}
+/**
+ * @brief bytes of the heaps, the mmapped blocks (metaData included) and the mmap
+ * cache that may take memory- all but the purged ones
+ */
+size_t _num_resident_bytes()
+{
+    size_t sum = 0;
+    for (Arena *arena = _mainArena(); arena < arenas + num_arenas; arena++)
+    {
+        ArenaLock lock(arena);
+        if (USE_REMOTE_FREE)
+            arena->drainRemoteFrees();
+        sum += arena->allocated_bytes + arena->allocated_blocks * meta_size - arena->purged_bytes;
+    }
+    pthread_mutex_lock(&mmap_cache_lock);
+    sum += mmap_cache_bytes;
+    pthread_mutex_unlock(&mmap_cache_lock);
+    return sum;
+}
+/**
+ * @brief large allocations that took a region from the mmap cache (USE_MMAP_CACHE)
+ */
+size_t _num_mmap_cache_hits()
+{
+    pthread_mutex_lock(&mmap_cache_lock);
+    size_t hits = mmap_cache_hits;
+    pthread_mutex_unlock(&mmap_cache_lock);
+    return hits;
+}
+/**
+ * @brief large allocations that found no region in the mmap cache, and mmapped a new one
+ */
+size_t _num_mmap_cache_misses()
+{
+    pthread_mutex_lock(&mmap_cache_lock);
+    size_t misses = mmap_cache_misses;
+    pthread_mutex_unlock(&mmap_cache_lock);
+    return misses;
+}
+size_t _num_mmap_cached_bytes()
+{
+    pthread_mutex_lock(&mmap_cache_lock);
+    size_t bytes = mmap_cache_bytes;
+    pthread_mutex_unlock(&mmap_cache_lock);
+    return bytes;
+}
+/**
+ * @brief mmap segments the arenas' heaps grew in (sbrk isn't counted)
+ */
+size_t _num_heap_segments()
+{
+    size_t sum = 0;
+    for (Arena *arena = _mainArena(); arena < arenas + num_arenas; arena++)
+    {
+        ArenaLock lock(arena);
+        sum += arena->segments;
+    }
+    return sum;
+}
+/**
+ * @brief system calls made so far. sbrk calls include the mprotect calls that
+ * commit or decommit segment pages, the sbrk of a segment
+ */
+size_t _num_sbrk_calls()
+{
+    return sbrk_calls.load(std::memory_order_relaxed);
+}
+size_t _num_mmap_calls()
+{
+    return mmap_calls.load(std::memory_order_relaxed);
+}
+size_t _num_munmap_calls()
+{
+    return munmap_calls.load(std::memory_order_relaxed);
+}
+size_t _num_arenas()
+{
+    pthread_once(&arenas_once, _setupArenas);
+    return num_arenas;
+}
+size_t _num_slabs()
+{
+    SlabLock lock;
+    return slabs_used;
+}
+size_t _num_slab_objects()
+{
+    SlabLock lock;
+    return slab_objects;
+}
+size_t _num_slab_bytes()
+{
+    SlabLock lock;
+    return slab_bytes;
+}
+
+/**
+ * @brief what smalloc_stats_print reports, summed over the arenas
+ */
+struct StatsSnapshot
+{
+    SizeClassStats size_classes[STATS_CLASSES];
+    size_t heap_blocks = 0;
+    size_t heap_bytes = 0;
+    size_t free_blocks = 0;
+    size_t free_bytes = 0;
+    size_t meta_data_bytes = 0;
+    size_t segments = 0;
+    size_t purged_bytes = 0;
+    size_t mmap_blocks = 0;
+    size_t mmap_bytes = 0;
+    size_t live_bytes = 0;
+    size_t live_bytes_of[MAX_ARENAS] = {0};
+    size_t peak_live_bytes_of[MAX_ARENAS] = {0};
+};
+
+/**
+ * @brief fills a snapshot. the arenas are locked one at a time, so while other
+ * threads allocate, the totals may mix slightly different moments
+ */
+void _takeSnapshot(StatsSnapshot &snapshot)
+{
+    for (Arena *arena = _mainArena(); arena < arenas + num_arenas; arena++)
+    {
+        ArenaLock lock(arena);
+        if (USE_REMOTE_FREE)
+            arena->drainRemoteFrees();
+        for (int i = 0; i < STATS_CLASSES; i++)
+        {
+            snapshot.size_classes[i].allocs += arena->size_classes[i].allocs;
+            snapshot.size_classes[i].frees += arena->size_classes[i].frees;
+            snapshot.size_classes[i].live_bytes += arena->size_classes[i].live_bytes;
+            snapshot.size_classes[i].splits += arena->size_classes[i].splits;
+            snapshot.size_classes[i].merges += arena->size_classes[i].merges;
+        }
+        snapshot.heap_blocks += arena->allocated_blocks - arena->mmap_blocks;
+        snapshot.heap_bytes += arena->allocated_bytes - arena->mmap_bytes;
+        if (arena->wilderness)
+            snapshot.free_blocks += arena->free_list.getSize() + arena->wilderness->is_free;
+        snapshot.free_bytes += arena->free_bytes;
+        snapshot.meta_data_bytes += arena->meta_data_bytes;
+        snapshot.segments += arena->segments;
+        snapshot.purged_bytes += arena->purged_bytes;
+        snapshot.mmap_blocks += arena->mmap_blocks;
+        snapshot.mmap_bytes += arena->mmap_bytes;
+        snapshot.live_bytes += arena->live_bytes;
+        snapshot.live_bytes_of[arena->id] = arena->live_bytes;
+        snapshot.peak_live_bytes_of[arena->id] = arena->peak_live_bytes;
+    }
+}
+
+/**
+ * @brief prints the allocator's statistics: per size class counters, the heap
+ * and mmap breakdown, live and peak bytes per arena, and syscall counts.
+ * blocks held by the thread caches and fast bins count as live, slab objects
+ * are only counted by the slab layer
+ *
+ * @param out where to print
+ * @param format "json" or "text"
+ * @return int 0 on success, EINVAL for a null stream or an unknown format
+ */
+int smalloc_stats_print(FILE *out, const char *format)
+{
+    if (!out || !format)
+        return EINVAL;
+    bool json = std::strcmp(format, "json") == 0;
+    if (!json && std::strcmp(format, "text") != 0)
+        return EINVAL;
+    StatsSnapshot snapshot;
+    _takeSnapshot(snapshot);
+    size_t slabs = _num_slabs(), objects = _num_slab_objects(), object_bytes = _num_slab_bytes();
+    size_t cached_bytes = _num_mmap_cached_bytes();
+    size_t hits = _num_mmap_cache_hits(), misses = _num_mmap_cache_misses();
+
+    if (json)
+    {
+        fprintf(out, "{\n  \"live_bytes\": %zu,\n", snapshot.live_bytes);
+        fprintf(out,
+                "  \"heap\": {\"blocks\": %zu, \"bytes\": %zu, \"free_blocks\": %zu, \"free_bytes\": %zu, "
+                "\"meta_data_bytes\": %zu, \"segments\": %zu, \"purged_bytes\": %zu},\n",
+                snapshot.heap_blocks, snapshot.heap_bytes, snapshot.free_blocks, snapshot.free_bytes,
+                snapshot.meta_data_bytes, snapshot.segments, snapshot.purged_bytes);
+        fprintf(out,
+                "  \"mmap\": {\"blocks\": %zu, \"bytes\": %zu, \"cached_bytes\": %zu, \"cache_hits\": %zu, "
+                "\"cache_misses\": %zu},\n",
+                snapshot.mmap_blocks, snapshot.mmap_bytes, cached_bytes, hits, misses);
+        fprintf(out, "  \"slabs\": {\"slabs\": %zu, \"objects\": %zu, \"bytes\": %zu},\n", slabs, objects,
+                object_bytes);
+        fprintf(out, "  \"syscalls\": {\"sbrk\": %zu, \"mmap\": %zu, \"munmap\": %zu},\n", _num_sbrk_calls(),
+                _num_mmap_calls(), _num_munmap_calls());
+        fprintf(out, "  \"arenas\": [");
+        for (int i = 0; i < num_arenas; i++)
+        {
+            fprintf(out, "%s\n    {\"id\": %d, \"live_bytes\": %zu, \"peak_live_bytes\": %zu}", i ? "," : "", i,
+                    snapshot.live_bytes_of[i], snapshot.peak_live_bytes_of[i]);
+        }
+        fprintf(out, "\n  ],\n  \"size_classes\": [");
+        bool first = true;
+        for (int i = 0; i < STATS_CLASSES; i++)
+        {
+            SizeClassStats &stats = snapshot.size_classes[i];
+            if (!stats.allocs && !stats.splits && !stats.merges)
+                continue;
+            fprintf(out,
+                    "%s\n    {\"min_size\": %zu, \"max_size\": %zu, \"allocs\": %zu, \"frees\": %zu, "
+                    "\"live_blocks\": %zu, \"live_bytes\": %zu, \"splits\": %zu, \"merges\": %zu}",
+                    first ? "" : ",", (size_t)1 << i, ((size_t)2 << i) - 1, stats.allocs, stats.frees,
+                    stats.allocs - stats.frees, stats.live_bytes, stats.splits, stats.merges);
+            first = false;
+        }
+        fprintf(out, "\n  ]\n}\n");
+        return 0;
+    }
+
+    fprintf(out, "live bytes: %zu\n", snapshot.live_bytes);
+    fprintf(out, "heap: %zu blocks, %zu bytes, %zu free blocks, %zu free bytes, %zu metaData bytes, %zu segments, "
+                 "%zu purged bytes\n",
+            snapshot.heap_blocks, snapshot.heap_bytes, snapshot.free_blocks, snapshot.free_bytes,
+            snapshot.meta_data_bytes, snapshot.segments, snapshot.purged_bytes);
+    fprintf(out, "mmap: %zu blocks, %zu bytes, %zu cached bytes, %zu cache hits, %zu cache misses\n",
+            snapshot.mmap_blocks, snapshot.mmap_bytes, cached_bytes, hits, misses);
+    fprintf(out, "slabs: %zu slabs, %zu objects, %zu bytes\n", slabs, objects, object_bytes);
+    fprintf(out, "syscalls: %zu sbrk, %zu mmap, %zu munmap\n", _num_sbrk_calls(), _num_mmap_calls(),
+            _num_munmap_calls());
+    for (int i = 0; i < num_arenas; i++)
+    {
+        fprintf(out, "arena %d: %zu live bytes, %zu peak live bytes\n", i, snapshot.live_bytes_of[i],
+                snapshot.peak_live_bytes_of[i]);
+    }
+    fprintf(out, "%12s %12s %10s %10s %10s %14s %10s %10s\n", "min size", "max size", "allocs", "frees", "live",
+            "live bytes", "splits", "merges");
+    for (int i = 0; i < STATS_CLASSES; i++)
+    {
+        SizeClassStats &stats = snapshot.size_classes[i];
+        if (!stats.allocs && !stats.splits && !stats.merges)
+            continue;
+        fprintf(out, "%12zu %12zu %10zu %10zu %10zu %14zu %10zu %10zu\n", (size_t)1 << i, ((size_t)2 << i) - 1,
+                stats.allocs, stats.frees, stats.allocs - stats.frees, stats.live_bytes, stats.splits,
+                stats.merges);
+    }
+    return 0;
+}
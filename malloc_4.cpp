@@ -0,0 +1,4 @@
+// malloc_3 with huge pages for large blocks and a dynamic mmap threshold
+#define USE_HUGE_PAGES 1
+#define DYNAMIC_MMAP_THRESHOLD 1
+#include "malloc_3.cpp"
@@ -0,0 +1,368 @@
+#include <iostream>
+#include <unistd.h>
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+#include <sys/mman.h>
+#define MIN_BLOCK_SIZE 128
+#define MAX_ORDER 10
+#define MAX_BLOCK_SIZE (MIN_BLOCK_SIZE << MAX_ORDER) // 128KB
+#define MMAP_ORDER (-1)
+
+#define PAYLOAD(x) ((uint8_t *)x + sizeof(MallocMetadata))
+
+/**
+ * Binary buddy allocator.
+ * The heap is made of MAX_BLOCK_SIZE blocks, each aligned to MAX_BLOCK_SIZE.
+ * A block of order k is MIN_BLOCK_SIZE << k bytes (metaData included), and its
+ * buddy is found by flipping bit k of its address. Requests larger than
+ * MAX_BLOCK_SIZE are mmapped.
+ */
+struct MallocMetadata
+{
+    size_t size; // whole block, metaData included
+    bool is_free;
+    int order; // MMAP_ORDER for mmapped blocks
+    MallocMetadata *next;
+    MallocMetadata *prev;
+};
+
+/**
+ * unsorted doubly linked list of free blocks of a single order
+ */
+class OrderList
+{
+private:
+    int size;
+    MallocMetadata *head;
+
+public:
+    OrderList() : size(0), head(nullptr){};
+    ~OrderList() = default;
+    MallocMetadata *begin();
+    void push(MallocMetadata *to_add);
+    void erase(MallocMetadata *to_delete);
+    int getSize();
+};
+MallocMetadata *OrderList::begin()
+{
+    return this->head;
+}
+void OrderList::push(MallocMetadata *to_add)
+{
+    to_add->prev = nullptr;
+    to_add->next = head;
+    if (head)
+        head->prev = to_add;
+    head = to_add;
+    this->size++;
+}
+void OrderList::erase(MallocMetadata *to_delete)
+{
+    if (to_delete->prev)
+        to_delete->prev->next = to_delete->next;
+    else
+        head = to_delete->next;
+    if (to_delete->next)
+        to_delete->next->prev = to_delete->prev;
+    this->size--;
+}
+int OrderList::getSize()
+{
+    return this->size;
+}
+
+const long max_size = (1e8);
+const size_t meta_size = sizeof(MallocMetadata);
+
+OrderList free_lists[MAX_ORDER + 1];
+OrderList mmap_list;
+size_t free_blocks = 0;
+size_t free_bytes = 0;
+size_t allocated_blocks = 0; // total num of blocks
+size_t allocated_bytes = 0;
+
+/**
+ * @brief smallest order whose blocks can hold block_size bytes
+ *
+ * @param block_size size in bytes, including metaData
+ * @return int the order. MMAP_ORDER if even MAX_ORDER is too small
+ */
+int orderOf(size_t block_size)
+{
+    if (block_size > MAX_BLOCK_SIZE)
+        return MMAP_ORDER;
+    int order = 0;
+    while (((size_t)MIN_BLOCK_SIZE << order) < block_size)
+        order++;
+    return order;
+}
+
+MallocMetadata *_buddyOf(MallocMetadata *block)
+{
+    return (MallocMetadata *)((uintptr_t)block ^ block->size);
+}
+
+void addFreeBlock(MallocMetadata *block)
+{
+    block->is_free = true;
+    free_lists[block->order].push(block);
+    free_blocks++;
+    free_bytes += block->size - meta_size;
+}
+
+void eraseFreeBlock(MallocMetadata *block)
+{
+    free_lists[block->order].erase(block);
+    block->is_free = false;
+    free_blocks--;
+    free_bytes -= block->size - meta_size;
+}
+
+/**
+ * @brief sbrks a new MAX_ORDER block and adds it to the free lists.
+ * the program break is padded first so the block is aligned to its size
+ *
+ * @return true on success
+ */
+bool _growHeap()
+{
+    uintptr_t brk = (uintptr_t)sbrk(0);
+    size_t padding = (MAX_BLOCK_SIZE - brk % MAX_BLOCK_SIZE) % MAX_BLOCK_SIZE;
+    void *ptr = sbrk(padding + MAX_BLOCK_SIZE);
+    if (ptr == (void *)(-1))
+    {
+        return false;
+    }
+    MallocMetadata *block = (MallocMetadata *)((uint8_t *)ptr + padding);
+    block->size = MAX_BLOCK_SIZE;
+    block->order = MAX_ORDER;
+
+    // stats:
+    allocated_blocks++;
+    allocated_bytes += MAX_BLOCK_SIZE - meta_size;
+    addFreeBlock(block);
+    return true;
+}
+
+/**
+ * @brief halves a used block until it is of the wanted order.
+ * the upper halves become free blocks
+ *
+ * @param block used block, not in any list
+ * @param order order to shrink to
+ */
+void _splitTo(MallocMetadata *block, int order)
+{
+    while (block->order > order)
+    {
+        block->order--;
+        block->size >>= 1;
+        MallocMetadata *buddy = (MallocMetadata *)((uint8_t *)block + block->size);
+        buddy->size = block->size;
+        buddy->order = block->order;
+
+        // stats:
+        allocated_blocks++;
+        allocated_bytes -= meta_size;
+        addFreeBlock(buddy);
+    }
+}
+
+/**
+ * @brief merges a block with its buddy. the buddy must be free and of the same order
+ *
+ * @return MallocMetadata* of the merged block (the lower of the two)
+ */
+MallocMetadata *_mergeBuddy(MallocMetadata *block, MallocMetadata *buddy)
+{
+    eraseFreeBlock(buddy);
+    MallocMetadata *lower = (block < buddy) ? block : buddy;
+    lower->size = block->size << 1;
+    lower->order = block->order + 1;
+
+    // stats:
+    allocated_blocks--;
+    allocated_bytes += meta_size;
+    return lower;
+}
+
+bool _isMergeable(MallocMetadata *block)
+{
+    if (block->order >= MAX_ORDER)
+        return false;
+    MallocMetadata *buddy = _buddyOf(block);
+    return buddy->is_free && buddy->order == block->order;
+}
+
+void *_smallocMmap(size_t block_size)
+{
+    void *ptr = mmap(NULL, block_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ptr == MAP_FAILED)
+    {
+        return nullptr;
+    }
+    MallocMetadata *block = (MallocMetadata *)ptr;
+    block->size = block_size;
+    block->is_free = false;
+    block->order = MMAP_ORDER;
+    mmap_list.push(block);
+
+    // stats:
+    allocated_blocks++;
+    allocated_bytes += block_size - meta_size;
+    return PAYLOAD(block);
+}
+
+void _sfreeMmap(MallocMetadata *block)
+{
+    mmap_list.erase(block);
+
+    // stats:
+    allocated_blocks--;
+    allocated_bytes -= block->size - meta_size;
+    if (munmap(block, block->size) != 0)
+    {
+        perror("unmapping failed.\n");
+    }
+}
+
+void *smalloc(size_t size)
+{
+    if (size == 0 || size > max_size)
+    {
+        return nullptr;
+    }
+    int order = orderOf(size + meta_size);
+    if (order == MMAP_ORDER)
+    {
+        return _smallocMmap(size + meta_size);
+    }
+
+    // smallest order that has a free block
+    int available = order;
+    while (available <= MAX_ORDER && free_lists[available].getSize() == 0)
+        available++;
+    if (available > MAX_ORDER)
+    {
+        if (!_growHeap())
+            return nullptr;
+        available = MAX_ORDER;
+    }
+    MallocMetadata *block = free_lists[available].begin();
+    eraseFreeBlock(block);
+    _splitTo(block, order);
+    return PAYLOAD(block);
+}
+
+void *scalloc(size_t num, size_t size)
+{
+    size_t total_size;
+    if (__builtin_mul_overflow(num, size, &total_size))
+        return nullptr;
+    void *ptr = smalloc(total_size);
+    if (!ptr)
+        return ptr;
+    std::memset(ptr, 0, total_size);
+    return ptr;
+}
+
+void sfree(void *p)
+{
+    if (!p)
+        return;
+    MallocMetadata *block = (MallocMetadata *)((uint8_t *)p - meta_size);
+    if (block->is_free)
+        return;
+    if (block->order == MMAP_ORDER)
+    {
+        _sfreeMmap(block);
+        return;
+    }
+    while (_isMergeable(block))
+    {
+        block = _mergeBuddy(block, _buddyOf(block));
+    }
+    addFreeBlock(block);
+}
+
+void *srealloc(void *oldp, size_t size)
+{
+    if (size == 0 || size > max_size)
+    {
+        return nullptr;
+    }
+    if (oldp == nullptr)
+    {
+        return smalloc(size);
+    }
+    MallocMetadata *block = (MallocMetadata *)((uint8_t *)oldp - meta_size);
+    size_t needed = size + meta_size;
+    if (block->size >= needed)
+    {
+        return oldp;
+    }
+
+    if (block->order != MMAP_ORDER && orderOf(needed) != MMAP_ORDER)
+    {
+        // check if merging with free buddies gives a block that is large enough
+        MallocMetadata *curr = block;
+        size_t curr_size = block->size;
+        int curr_order = block->order;
+        while (curr_size < needed && curr_order < MAX_ORDER)
+        {
+            MallocMetadata *buddy = (MallocMetadata *)((uintptr_t)curr ^ curr_size);
+            if (!buddy->is_free || buddy->order != curr_order)
+                break;
+            curr = (curr < buddy) ? curr : buddy;
+            curr_size <<= 1;
+            curr_order++;
+        }
+        if (curr_size >= needed)
+        {
+            size_t old_size = block->size;
+            MallocMetadata *merged = block;
+            while (merged->size < needed)
+            {
+                merged = _mergeBuddy(merged, _buddyOf(merged));
+            }
+            if (merged != block)
+            {
+                std::memmove(PAYLOAD(merged), oldp, old_size - meta_size);
+            }
+            return PAYLOAD(merged);
+        }
+    }
+
+    void *ptr = smalloc(size);
+    if (!ptr)
+        return ptr;
+    std::memmove(ptr, oldp, block->size - meta_size);
+    sfree(oldp);
+    return ptr;
+}
+
+size_t _num_free_blocks()
+{
+    return free_blocks;
+}
+size_t _num_free_bytes()
+{
+    return free_bytes;
+}
+size_t _num_allocated_blocks()
+{
+    return allocated_blocks;
+}
+size_t _num_allocated_bytes()
+{
+    return allocated_bytes;
+}
+size_t _size_meta_data()
+{
+    return meta_size;
+}
+size_t _num_meta_data_bytes()
+{
+    return _size_meta_data() * _num_allocated_blocks();
+}
@@ -0,0 +1,193 @@
+#include "my_stdlib.h"
+#include <catch2/catch_test_macros.hpp>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <unistd.h>
+
+#define MAX_ALLOCATION_SIZE (1e8)
+#define MMAP_THRESHOLD (128 * 1024)
+
+#define verify_blocks(allocated_blocks, allocated_bytes, free_blocks, free_bytes)                                      \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        REQUIRE(_num_allocated_blocks() == (size_t)(allocated_blocks));                                                \
+        REQUIRE(_num_allocated_bytes() == (size_t)(allocated_bytes));                                                  \
+        REQUIRE(_num_free_blocks() == (size_t)(free_blocks));                                                          \
+        REQUIRE(_num_free_bytes() == (size_t)(free_bytes));                                                            \
+        REQUIRE(_num_meta_data_bytes() == _size_meta_data() * (allocated_blocks));                                     \
+    } while (0)
+
+// everything was freed and merged back into the wilderness
+#define verify_merged()                                                                                                \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        REQUIRE(_num_allocated_blocks() == 1);                                                                         \
+        REQUIRE(_num_free_blocks() == 1);                                                                              \
+        REQUIRE(_num_allocated_bytes() == _num_free_bytes());                                                          \
+    } while (0)
+
+TEST_CASE("Aligned allocation", "[aligned]")
+{
+    char *a = (char *)smemalign(4096, 100);
+    REQUIRE(a != nullptr);
+    REQUIRE((uintptr_t)a % 4096 == 0);
+    std::memset(a, 'a', 100);
+
+    // the slack below a and the rest above it (if it's large enough to split) are free blocks
+    REQUIRE(_num_allocated_bytes() - _num_free_bytes() >= 104);
+    REQUIRE(_num_allocated_bytes() - _num_free_bytes() < 104 + 128 + _size_meta_data());
+    REQUIRE(_num_allocated_blocks() == _num_free_blocks() + 1);
+    REQUIRE(_num_free_blocks() <= 2);
+
+    sfree(a);
+    verify_merged();
+}
+
+TEST_CASE("Small alignments", "[aligned]")
+{
+    char *a = (char *)smemalign(8, 10);
+    REQUIRE(a != nullptr);
+    verify_blocks(1, 16, 0, 0);
+    sfree(a);
+
+    for (size_t alignment = 16; alignment <= 1024; alignment *= 2)
+    {
+        char *b = (char *)saligned_alloc(alignment, 24);
+        REQUIRE(b != nullptr);
+        REQUIRE((uintptr_t)b % alignment == 0);
+        std::memset(b, 'b', 24);
+        sfree(b);
+    }
+    verify_merged();
+}
+
+TEST_CASE("Aligned blocks between others", "[aligned]")
+{
+    char *blocks[16];
+    size_t sizes[16];
+    for (int i = 0; i < 16; i++)
+    {
+        sizes[i] = 50 + 70 * i;
+        if (i % 2 == 0)
+        {
+            size_t alignment = (size_t)16 << (i / 2);
+            blocks[i] = (char *)smemalign(alignment, sizes[i]);
+            REQUIRE(blocks[i] != nullptr);
+            REQUIRE((uintptr_t)blocks[i] % alignment == 0);
+        }
+        else
+        {
+            blocks[i] = (char *)smalloc(sizes[i]);
+            REQUIRE(blocks[i] != nullptr);
+        }
+        std::memset(blocks[i], 'a' + i, sizes[i]);
+    }
+    for (int i = 0; i < 16; i++)
+    {
+        for (size_t j = 0; j < sizes[i]; j++)
+        {
+            REQUIRE(blocks[i][j] == 'a' + i);
+        }
+    }
+    for (int i = 0; i < 16; i += 2)
+    {
+        sfree(blocks[i]);
+    }
+    for (int i = 1; i < 16; i += 2)
+    {
+        sfree(blocks[i]);
+    }
+    verify_merged();
+}
+
+TEST_CASE("Aligned block from a freed larger block", "[aligned]")
+{
+    // pad the heap so the next block's payload lands on a 256 byte boundary
+    char *probe = (char *)smalloc(1000);
+    REQUIRE(probe != nullptr);
+    sfree(probe);
+    size_t shift = (256 - (uintptr_t)probe % 256) % 256;
+    char *pad = nullptr;
+    if (shift != 0)
+    {
+        if (shift < 48)
+            shift += 256;
+        pad = (char *)smalloc(shift - _size_meta_data());
+        REQUIRE(pad != nullptr);
+    }
+    char *a = (char *)smalloc(1000);
+    REQUIRE((uintptr_t)a % 256 == 0);
+    char *guard = (char *)smalloc(10);
+    REQUIRE(guard != nullptr);
+    sfree(a);
+    size_t blocks = _num_allocated_blocks();
+    size_t free_blocks = _num_free_blocks();
+    size_t free_bytes = _num_free_bytes();
+
+    // no slack below b, the excess above it merges back with the rest of a's block
+    char *b = (char *)smemalign(256, 100);
+    REQUIRE(b == a);
+    REQUIRE(_num_allocated_blocks() == blocks + 1);
+    REQUIRE(_num_free_blocks() == free_blocks);
+    REQUIRE(_num_free_bytes() == free_bytes - 104 - _size_meta_data());
+
+    sfree(b);
+    REQUIRE(_num_allocated_blocks() == blocks);
+    REQUIRE(_num_free_blocks() == free_blocks);
+    REQUIRE(_num_free_bytes() == free_bytes);
+    sfree(guard);
+    sfree(pad);
+    verify_merged();
+}
+
+TEST_CASE("Aligned large allocation", "[aligned]")
+{
+    void *base = sbrk(0);
+    char *a = (char *)smemalign(4096, MMAP_THRESHOLD);
+    REQUIRE(a != nullptr);
+    REQUIRE((uintptr_t)a % 4096 == 0);
+    char *b = (char *)smemalign(1 << 20, MMAP_THRESHOLD + 100);
+    REQUIRE(b != nullptr);
+    REQUIRE((uintptr_t)b % (1 << 20) == 0);
+    REQUIRE(sbrk(0) == base);
+    verify_blocks(2, 2 * MMAP_THRESHOLD + 104, 0, 0);
+    std::memset(a, 'a', MMAP_THRESHOLD);
+    std::memset(b, 'b', MMAP_THRESHOLD + 100);
+
+    // still an mmapped block, just with the metaData off the page start
+    char *c = (char *)srealloc(a, 4 * MMAP_THRESHOLD);
+    REQUIRE(c != nullptr);
+    REQUIRE(c[MMAP_THRESHOLD - 1] == 'a');
+    verify_blocks(2, 5 * MMAP_THRESHOLD + 104, 0, 0);
+    sfree(b);
+    sfree(c);
+    verify_blocks(0, 0, 0, 0);
+    REQUIRE(sbrk(0) == base);
+}
+
+TEST_CASE("Aligned allocation failures", "[aligned]")
+{
+    void *base = sbrk(0);
+    REQUIRE(smemalign(3, 10) == nullptr);
+    REQUIRE(smemalign(0, 10) == nullptr);
+    REQUIRE(smemalign(64, 0) == nullptr);
+    REQUIRE(smemalign(64, MAX_ALLOCATION_SIZE + 1) == nullptr);
+
+    void *p = (void *)&base;
+    REQUIRE(sposix_memalign(&p, 4, 10) == EINVAL);
+    REQUIRE(sposix_memalign(&p, 24, 10) == EINVAL);
+    REQUIRE(sposix_memalign(&p, 64, MAX_ALLOCATION_SIZE + 1) == ENOMEM);
+    REQUIRE(p == (void *)&base);
+    REQUIRE(sposix_memalign(&p, 64, 0) == 0);
+    REQUIRE(p == nullptr);
+    REQUIRE(sbrk(0) == base);
+    verify_blocks(0, 0, 0, 0);
+
+    REQUIRE(sposix_memalign(&p, 64, 10) == 0);
+    REQUIRE(p != nullptr);
+    REQUIRE((uintptr_t)p % 64 == 0);
+    sfree(p);
+    verify_merged();
+}
@@ -0,0 +1,156 @@
+#include "my_stdlib.h"
+#include <catch2/catch_test_macros.hpp>
+
+#include <atomic>
+#include <thread>
+#include <unistd.h>
+
+#define NUM_ARENAS (4)
+
+TEST_CASE("Arena count", "[arenas]")
+{
+    REQUIRE(_num_arenas() == NUM_ARENAS);
+}
+
+TEST_CASE("Threads get their own arenas", "[arenas]")
+{
+    void *base = sbrk(0);
+    char *a = (char *)smalloc(100);
+    REQUIRE(a != nullptr);
+    void *after_main = sbrk(0);
+    REQUIRE(after_main != base);
+
+    // the next threads are bound to the other arenas, which don't use sbrk
+    char *others[NUM_ARENAS - 1];
+    for (int i = 0; i < NUM_ARENAS - 1; i++)
+    {
+        std::thread worker([&others, i]() { others[i] = (char *)smalloc(100); });
+        worker.join();
+        REQUIRE(others[i] != nullptr);
+    }
+    REQUIRE(sbrk(0) == after_main);
+    for (int i = 0; i < NUM_ARENAS - 1; i++)
+    {
+        REQUIRE((others[i] < (char *)base || others[i] >= (char *)after_main));
+        for (int j = 0; j < i; j++)
+        {
+            REQUIRE(others[i] != others[j]);
+        }
+    }
+    REQUIRE(_num_allocated_blocks() == NUM_ARENAS);
+    REQUIRE(_num_allocated_bytes() == NUM_ARENAS * 104);
+
+    // a block is returned to its own arena, whichever thread frees it
+    for (int i = 0; i < NUM_ARENAS - 1; i++)
+    {
+        sfree(others[i]);
+    }
+    REQUIRE(_num_free_blocks() == NUM_ARENAS - 1);
+    REQUIRE(_num_free_bytes() == (NUM_ARENAS - 1) * 104);
+    sfree(a);
+    REQUIRE(_num_free_blocks() == NUM_ARENAS);
+}
+
+TEST_CASE("Large blocks in other arenas", "[arenas]")
+{
+    std::thread first([]() { sfree(smalloc(10)); });
+    first.join();
+    char *big = nullptr;
+    std::thread worker([&big]() { big = (char *)smalloc(128 * 1024); });
+    worker.join();
+    REQUIRE(big != nullptr);
+    size_t blocks = _num_allocated_blocks();
+    sfree(big);
+    REQUIRE(_num_allocated_blocks() == blocks - 1);
+}
+
+TEST_CASE("Arenas work concurrently", "[arenas]")
+{
+    const int threads = 2 * NUM_ARENAS;
+    const int rounds = 5000;
+    std::atomic<int> errors(0);
+    std::thread workers[threads];
+    for (int t = 0; t < threads; t++)
+    {
+        workers[t] = std::thread([t, &errors]() {
+            char *live[16] = {nullptr};
+            for (int i = 0; i < rounds; i++)
+            {
+                int slot = i % 16;
+                if (live[slot] && live[slot][0] != (char)t)
+                    errors++;
+                sfree(live[slot]);
+                live[slot] = (char *)smalloc(8 + (i * 13 + t) % 3000);
+                if (!live[slot])
+                    errors++;
+                else
+                    live[slot][0] = (char)t;
+            }
+            for (int slot = 0; slot < 16; slot++)
+            {
+                sfree(live[slot]);
+            }
+        });
+    }
+    for (int t = 0; t < threads; t++)
+    {
+        workers[t].join();
+    }
+    REQUIRE(errors == 0);
+    REQUIRE(_num_free_bytes() == _num_allocated_bytes());
+}
+
+TEST_CASE("Large reallocations race with other arenas", "[arenas]")
+{
+    const int threads = NUM_ARENAS;
+    const int rounds = 3000;
+    std::atomic<int> errors(0);
+    std::thread workers[threads];
+    for (int t = 0; t < threads; t++)
+    {
+        workers[t] = std::thread([t, &errors]() {
+            // mmapped blocks are resized in place, moved and freed while the others map and free theirs
+            char *live[8] = {nullptr};
+            size_t sizes[8] = {0};
+            unsigned seed = 7 * t + 1;
+            for (int i = 0; i < rounds; i++)
+            {
+                seed = seed * 1103515245 + 12345;
+                int slot = (seed >> 8) % 8;
+                size_t size = 64 * 1024 + (seed >> 12) % (512 * 1024);
+                char tag = (char)(t * 16 + slot);
+                if (live[slot] && (live[slot][0] != tag || live[slot][sizes[slot] - 1] != tag))
+                    errors++;
+                if (live[slot] && seed % 3 == 0)
+                {
+                    char *p = (char *)srealloc(live[slot], size);
+                    if (!p || p[0] != tag || (size >= sizes[slot] && p[sizes[slot] - 1] != tag))
+                        errors++;
+                    live[slot] = p;
+                }
+                else
+                {
+                    sfree(live[slot]);
+                    live[slot] = (char *)scalloc(1, size);
+                    if (!live[slot] || live[slot][0] != 0 || live[slot][size - 1] != 0)
+                        errors++;
+                }
+                if (!live[slot])
+                    continue;
+                sizes[slot] = size;
+                live[slot][0] = tag;
+                live[slot][size - 1] = tag;
+            }
+            for (int slot = 0; slot < 8; slot++)
+            {
+                sfree(live[slot]);
+            }
+        });
+    }
+    for (int t = 0; t < threads; t++)
+    {
+        workers[t].join();
+    }
+    REQUIRE(errors == 0);
+    REQUIRE(_num_free_bytes() == _num_allocated_bytes());
+}
@@ -250,7 +250,7 @@ TEST_CASE("free 3", "[malloc3]")
     verify_size(base);
 }
 
-TEST_CASE("free holes 1", "[malloc3]")
+TEST_CASE("free holes 1", "[malloc3][best_fit]")
 {
     //verify_blocks(0, 0, 0, 0);
 
@@ -362,7 +362,7 @@ TEST_CASE("free holes 2", "[malloc3]")
     verify_size(base);
 }
 
-TEST_CASE("free holes 3", "[malloc3]")
+TEST_CASE("free holes 3", "[malloc3][best_fit]")
 {
     //verify_blocks(0, 0, 0, 0);
 
@@ -538,6 +538,28 @@ TEST_CASE("Large unaligned allocation", "[malloc3]")
     verify_size(base);
 }
 
+TEST_CASE("Many large allocations", "[malloc3]")
+{
+    void *base = sbrk(0);
+    const int count = 200;
+    char *blocks[count];
+    for (int i = 0; i < count; i++)
+    {
+        blocks[i] = (char *)smalloc(MMAP_THRESHOLD + 8 * i);
+        REQUIRE(blocks[i] != nullptr);
+    }
+    REQUIRE(sbrk(0) == base);
+    verify_blocks(count, count * MMAP_THRESHOLD + 8 * (count - 1) * count / 2, 0, 0);
+
+    // free in an order unrelated to size or address
+    for (int i = 0; i < count; i++)
+    {
+        sfree(blocks[(i * 7) % count]);
+    }
+    verify_blocks(0, 0, 0, 0);
+    verify_size(base);
+}
+
 TEST_CASE("Alignment", "[malloc3]")
 {
     //verify_blocks(0, 0, 0, 0);
@@ -0,0 +1,122 @@
+#include "my_stdlib.h"
+#include <catch2/catch_test_macros.hpp>
+
+#include <unistd.h>
+
+#define MMAP_THRESHOLD (128 * 1024)
+#define BATCH (10)
+
+#define verify_blocks(allocated_blocks, allocated_bytes, free_blocks, free_bytes)                                      \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        REQUIRE(_num_allocated_blocks() == (size_t)(allocated_blocks));                                                \
+        REQUIRE(_num_allocated_bytes() == (size_t)(allocated_bytes));                                                  \
+        REQUIRE(_num_free_blocks() == (size_t)(free_blocks));                                                          \
+        REQUIRE(_num_free_bytes() == (size_t)(free_bytes));                                                            \
+        REQUIRE(_num_meta_data_bytes() == _size_meta_data() * (allocated_blocks));                                     \
+    } while (0)
+
+TEST_CASE("Batch allocation extends the heap once", "[batch]")
+{
+    void *base = sbrk(0);
+    void *ptrs[BATCH];
+    REQUIRE(smalloc_batch(100, BATCH, ptrs) == BATCH);
+    size_t block_size = 104 + _size_meta_data();
+    for (int i = 1; i < BATCH; i++)
+    {
+        REQUIRE((char *)ptrs[i] == (char *)ptrs[i - 1] + block_size);
+    }
+    verify_blocks(BATCH, BATCH * 104, 0, 0);
+    REQUIRE((size_t)sbrk(0) - (size_t)base == BATCH * block_size);
+
+    sfree_batch(ptrs, BATCH);
+    verify_blocks(1, BATCH * block_size - _size_meta_data(), 1, BATCH * block_size - _size_meta_data());
+}
+
+TEST_CASE("Batch allocation carves a free block", "[batch]")
+{
+    char *a = (char *)smalloc(2000);
+    char *guard = (char *)smalloc(100);
+    REQUIRE(guard != nullptr);
+    sfree(a);
+
+    void *base = sbrk(0);
+    void *ptrs[BATCH];
+    REQUIRE(smalloc_batch(100, BATCH, ptrs) == BATCH);
+    REQUIRE(sbrk(0) == base);
+    REQUIRE(ptrs[0] == a);
+    size_t block_size = 104 + _size_meta_data();
+    size_t rest = 2000 + _size_meta_data() - BATCH * block_size;
+    verify_blocks(BATCH + 2, BATCH * 104 + 104 + rest - _size_meta_data(), 1, rest - _size_meta_data());
+
+    sfree_batch(ptrs, BATCH);
+    verify_blocks(2, 2000 + 104, 1, 2000);
+    sfree(guard);
+}
+
+TEST_CASE("Batch free merges in any order", "[batch][best_fit]")
+{
+    void *ptrs[BATCH];
+    REQUIRE(smalloc_batch(200, BATCH, ptrs) == BATCH);
+    char *guard = (char *)smalloc(100);
+    REQUIRE(guard != nullptr);
+
+    void *shuffled[BATCH];
+    for (int i = 0; i < BATCH; i++)
+    {
+        shuffled[i] = ptrs[(i * 3) % BATCH];
+    }
+    sfree_batch(shuffled, BATCH);
+    size_t block_size = 200 + _size_meta_data();
+    verify_blocks(2, BATCH * block_size - _size_meta_data() + 104, 1, BATCH * block_size - _size_meta_data());
+
+    // the merged block is reused as a whole
+    REQUIRE(smalloc(BATCH * block_size - _size_meta_data()) == ptrs[0]);
+}
+
+TEST_CASE("Batch free of some blocks", "[batch]")
+{
+    void *ptrs[BATCH];
+    REQUIRE(smalloc_batch(200, BATCH, ptrs) == BATCH);
+    size_t block_size = 200 + _size_meta_data();
+
+    // every other block, nulls and a large block
+    void *some[BATCH / 2 + 2];
+    for (int i = 0; i < BATCH / 2; i++)
+    {
+        some[i] = ptrs[2 * i];
+    }
+    some[BATCH / 2] = nullptr;
+    some[BATCH / 2 + 1] = smalloc(MMAP_THRESHOLD);
+    REQUIRE(some[BATCH / 2 + 1] != nullptr);
+    sfree_batch(some, BATCH / 2 + 2);
+    verify_blocks(BATCH, BATCH * 200, BATCH / 2, BATCH / 2 * 200);
+
+    // the rest, including the wilderness
+    for (int i = 0; i < BATCH / 2; i++)
+    {
+        some[i] = ptrs[2 * i + 1];
+    }
+    sfree_batch(some, BATCH / 2);
+    verify_blocks(1, BATCH * block_size - _size_meta_data(), 1, BATCH * block_size - _size_meta_data());
+}
+
+TEST_CASE("Batch allocation of invalid sizes", "[batch]")
+{
+    void *ptrs[BATCH];
+    REQUIRE(smalloc_batch(0, BATCH, ptrs) == 0);
+    REQUIRE(smalloc_batch(1e8 + 1, BATCH, ptrs) == 0);
+    REQUIRE(smalloc_batch(100, 0, ptrs) == 0);
+    sfree_batch(ptrs, 0);
+}
+
+TEST_CASE("Batch allocation of large blocks", "[batch]")
+{
+    void *ptrs[3];
+    void *base = sbrk(0);
+    REQUIRE(smalloc_batch(MMAP_THRESHOLD, 3, ptrs) == 3);
+    REQUIRE(sbrk(0) == base);
+    verify_blocks(3, 3 * MMAP_THRESHOLD, 0, 0);
+    sfree_batch(ptrs, 3);
+    verify_blocks(0, 0, 0, 0);
+}
@@ -0,0 +1,229 @@
+#include "my_stdlib.h"
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstring>
+#include <unistd.h>
+
+#define HEADER_SIZE (8)
+#define MIN_BLOCK_SIZE (40) // header, free list links, tree level and tip
+
+#define verify_blocks(allocated_blocks, allocated_bytes, free_blocks, free_bytes)                                      \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        REQUIRE(_num_allocated_blocks() == (size_t)(allocated_blocks));                                                \
+        REQUIRE(_num_allocated_bytes() == (size_t)(allocated_bytes));                                                  \
+        REQUIRE(_num_free_blocks() == (size_t)(free_blocks));                                                          \
+        REQUIRE(_num_free_bytes() == (size_t)(free_bytes));                                                            \
+        REQUIRE(_num_meta_data_bytes() == _size_meta_data() * (allocated_blocks));                                     \
+    } while (0)
+
+#define verify_size(base)                                                                                              \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        void *after = sbrk(0);                                                                                         \
+        REQUIRE(_num_allocated_bytes() + _num_meta_data_bytes() == (size_t)after - (size_t)base);                      \
+    } while (0)
+
+static void populate(char *array, size_t len, char seed)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        array[i] = (char)(seed + i);
+    }
+}
+
+static bool validate(char *array, size_t len, char seed)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        if (array[i] != (char)(seed + i))
+            return false;
+    }
+    return true;
+}
+
+TEST_CASE("Compact metaData", "[compact]")
+{
+    REQUIRE(_size_meta_data() == HEADER_SIZE);
+    void *base = sbrk(0);
+    char *a = (char *)smalloc(100);
+    REQUIRE(a != nullptr);
+    REQUIRE((size_t)a % 8 == 0);
+    verify_blocks(1, 104, 0, 0);
+    verify_size(base);
+
+    char *b = (char *)smalloc(100);
+    REQUIRE(b == a + 104 + HEADER_SIZE);
+    verify_blocks(2, 208, 0, 0);
+    verify_size(base);
+
+    sfree(b);
+    sfree(a);
+    verify_blocks(1, 208 + HEADER_SIZE, 1, 208 + HEADER_SIZE);
+    verify_size(base);
+}
+
+TEST_CASE("Small blocks are big enough to be freed", "[compact]")
+{
+    void *base = sbrk(0);
+    char *a = (char *)smalloc(1);
+    char *b = (char *)smalloc(1);
+    REQUIRE(a != nullptr);
+    REQUIRE(b == a + MIN_BLOCK_SIZE);
+    verify_blocks(2, 2 * (MIN_BLOCK_SIZE - HEADER_SIZE), 0, 0);
+    verify_size(base);
+
+    char *c = (char *)smalloc(10);
+    sfree(a);
+    verify_blocks(3, 3 * (MIN_BLOCK_SIZE - HEADER_SIZE), 1, MIN_BLOCK_SIZE - HEADER_SIZE);
+    REQUIRE(smalloc(1) == a);
+    sfree(a);
+    sfree(b);
+    sfree(c);
+    verify_blocks(1, 3 * MIN_BLOCK_SIZE - HEADER_SIZE, 1, 3 * MIN_BLOCK_SIZE - HEADER_SIZE);
+}
+
+TEST_CASE("Free merges with both neighbours", "[compact]")
+{
+    void *base = sbrk(0);
+    char *a = (char *)smalloc(200);
+    char *b = (char *)smalloc(200);
+    char *c = (char *)smalloc(200);
+    char *d = (char *)smalloc(200);
+    REQUIRE(d != nullptr);
+
+    sfree(a);
+    sfree(c);
+    verify_blocks(4, 800, 2, 400);
+
+    // b finds both neighbours free through its prev_free bit and c's header
+    sfree(b);
+    verify_blocks(2, 800 + 2 * HEADER_SIZE, 1, 600 + 2 * HEADER_SIZE);
+    verify_size(base);
+
+    // the merged block is reused as a whole
+    char *e = (char *)smalloc(600 + 2 * HEADER_SIZE);
+    REQUIRE(e == a);
+    sfree(e);
+    sfree(d);
+    verify_blocks(1, 800 + 3 * HEADER_SIZE, 1, 800 + 3 * HEADER_SIZE);
+}
+
+TEST_CASE("Tips stay out of used payloads", "[compact]")
+{
+    char *a = (char *)smalloc(400);
+    char *b = (char *)smalloc(400);
+    char *c = (char *)smalloc(400);
+    REQUIRE(c != nullptr);
+    populate(a, 400, 'a');
+    populate(b, 400, 'b');
+    populate(c, 400, 'c');
+
+    // freeing a and c writes their tips and b's prev_free bit, not b's data
+    sfree(a);
+    sfree(c);
+    REQUIRE(validate(b, 400, 'b'));
+
+    // shrinking splits b, the tip of the free tail is past its new size
+    REQUIRE(srealloc(b, 200) == b);
+    REQUIRE(validate(b, 200, 'b'));
+
+    // growing into the free previous block moves the data down
+    char *d = (char *)srealloc(b, 500);
+    REQUIRE(d == a);
+    REQUIRE(validate(d, 200, 'b'));
+    sfree(d);
+}
+
+TEST_CASE("Aligned small blocks are big enough to be freed", "[compact]")
+{
+    char *aligned[8];
+    char *used[8];
+    char *fillers[8];
+    for (int i = 0; i < 8; i++)
+    {
+        size_t used_bytes = _num_allocated_bytes() - _num_free_bytes();
+        aligned[i] = (char *)smemalign(16, 1);
+        REQUIRE(aligned[i] != nullptr);
+        REQUIRE((uintptr_t)aligned[i] % 16 == 0);
+        REQUIRE(_num_allocated_bytes() - _num_free_bytes() - used_bytes >= MIN_BLOCK_SIZE - HEADER_SIZE);
+        used[i] = (char *)smalloc(100);
+        REQUIRE(used[i] != nullptr);
+        populate(used[i], 100, 'a' + i);
+    }
+    // take the slack below the aligned blocks, so they are freed on their own
+    for (int i = 0; i < 8; i++)
+    {
+        fillers[i] = (char *)smalloc(MIN_BLOCK_SIZE - HEADER_SIZE);
+        REQUIRE(fillers[i] != nullptr);
+    }
+
+    // every freed aligned block holds its links, tree level and tip without touching its neighbours
+    for (int i = 0; i < 8; i++)
+    {
+        sfree(aligned[i]);
+    }
+    for (int i = 0; i < 8; i++)
+    {
+        REQUIRE(validate(used[i], 100, 'a' + i));
+    }
+    for (int i = 0; i < 8; i++)
+    {
+        aligned[i] = (char *)smemalign(16, 1);
+        REQUIRE(aligned[i] != nullptr);
+        REQUIRE((uintptr_t)aligned[i] % 16 == 0);
+    }
+    for (int i = 0; i < 8; i++)
+    {
+        REQUIRE(validate(used[i], 100, 'a' + i));
+        sfree(used[i]);
+        sfree(aligned[i]);
+        sfree(fillers[i]);
+    }
+    REQUIRE(_num_allocated_blocks() == 1);
+    REQUIRE(_num_free_blocks() == 1);
+    REQUIRE(_num_allocated_bytes() == _num_free_bytes());
+}
+
+static bool is_zero(const char *array, size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        if (array[i] != 0)
+            return false;
+    }
+    return true;
+}
+
+TEST_CASE("scalloc of a fresh mapping is zero", "[compact]")
+{
+    // next/prev of a used block lie in its payload, they must not carry anything into it
+    char *a = (char *)scalloc(1, 200000);
+    REQUIRE(a != nullptr);
+    REQUIRE(is_zero(a, 200000));
+    char *b = (char *)scalloc(200, 1000);
+    REQUIRE(b != nullptr);
+    REQUIRE(is_zero(b, 200000));
+    sfree(a);
+    sfree(b);
+}
+
+TEST_CASE("scalloc of a grown wilderness is zero", "[compact]")
+{
+    char *a = (char *)smalloc(100);
+    REQUIRE(a != nullptr);
+    // fill the used wilderness up to a page boundary, so the next block's header starts a fresh page
+    size_t gap = (4096 - (uintptr_t)sbrk(0) % 4096) % 4096;
+    if (gap < MIN_BLOCK_SIZE)
+        gap += 4096;
+    char *b = (char *)smalloc(gap - HEADER_SIZE);
+    REQUIRE(b != nullptr);
+    REQUIRE((uintptr_t)sbrk(0) % 4096 == 0);
+
+    char *c = (char *)scalloc(1, 1000);
+    REQUIRE(c == (char *)sbrk(0) - 1000);
+    REQUIRE(is_zero(c, 1000));
+    sfree(a);
+    sfree(b);
+    sfree(c);
+}
@@ -0,0 +1,210 @@
+#include "my_stdlib.h"
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// built with USE_PURGE and PURGE_DECAY_MS = DECAY_MS
+#define DECAY_MS 200
+#define PAGE_SIZE 4096
+
+#define verify_resident()                                                                                              \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        REQUIRE(_num_resident_bytes() ==                                                                               \
+                _num_allocated_bytes() + _size_meta_data() * _num_allocated_blocks() - _num_purged_bytes());           \
+    } while (0)
+
+// how many of the whole pages in [p, p + size) are in memory
+static size_t resident_pages(void *p, size_t size)
+{
+    uintptr_t start = ((uintptr_t)p + PAGE_SIZE - 1) & ~(uintptr_t)(PAGE_SIZE - 1);
+    uintptr_t end = ((uintptr_t)p + size) & ~(uintptr_t)(PAGE_SIZE - 1);
+    if (end <= start)
+        return 0;
+    unsigned char vec[(end - start) / PAGE_SIZE];
+    REQUIRE(mincore((void *)start, end - start, vec) == 0);
+    size_t count = 0;
+    for (size_t i = 0; i < (end - start) / PAGE_SIZE; i++)
+        count += vec[i] & 1;
+    return count;
+}
+
+TEST_CASE("Free pages decay in the background", "[decay]")
+{
+    char *a = (char *)smalloc(100 * 1024);
+    char *guard = (char *)smalloc(10);
+    REQUIRE(a != nullptr);
+    REQUIRE(guard != nullptr);
+    std::memset(a, 'a', 100 * 1024);
+
+    // sfree doesn't purge
+    sfree(a);
+    size_t dirty = _num_dirty_bytes();
+    REQUIRE(dirty >= 100 * 1024 - 2 * PAGE_SIZE);
+    REQUIRE(_num_muzzy_bytes() == 0);
+    REQUIRE(_num_purged_bytes() == 0);
+    REQUIRE(resident_pages(a + PAGE_SIZE, 100 * 1024 - 2 * PAGE_SIZE) > 0);
+    verify_resident();
+
+    // dirty -> muzzy -> clean, each within the decay time
+    for (int i = 0; i < 10 * DECAY_MS / 10 && _num_purged_bytes() == 0; i++)
+    {
+        usleep(10 * 1000);
+        REQUIRE(_num_dirty_bytes() + _num_muzzy_bytes() + _num_purged_bytes() == dirty);
+    }
+    REQUIRE(_num_purged_bytes() == dirty);
+    REQUIRE(_num_dirty_bytes() == 0);
+    REQUIRE(_num_muzzy_bytes() == 0);
+    REQUIRE(resident_pages(a + PAGE_SIZE, 100 * 1024 - 2 * PAGE_SIZE) == 0);
+    verify_resident();
+
+    sfree(guard);
+}
+
+TEST_CASE("Free pages decay gradually", "[decay]")
+{
+    char *blocks[8];
+    char *guards[8];
+    for (int i = 0; i < 8; i++)
+    {
+        blocks[i] = (char *)smalloc(100 * 1024);
+        guards[i] = (char *)smalloc(10);
+        REQUIRE(blocks[i] != nullptr);
+        std::memset(blocks[i], 'a', 100 * 1024);
+    }
+    for (int i = 0; i < 8; i++)
+    {
+        sfree(blocks[i]);
+    }
+    size_t dirty = _num_dirty_bytes();
+    REQUIRE(dirty >= 8 * (100 * 1024 - 2 * PAGE_SIZE));
+
+    bool partly = false;
+    for (int i = 0; i < 10 * DECAY_MS / 5 && _num_dirty_bytes() > 0; i++)
+    {
+        usleep(5 * 1000);
+        size_t now = _num_dirty_bytes();
+        partly |= now > 0 && now < dirty;
+    }
+    REQUIRE(partly);
+    REQUIRE(_num_dirty_bytes() == 0);
+
+    for (int i = 0; i < 8; i++)
+    {
+        sfree(guards[i]);
+    }
+}
+
+TEST_CASE("Reused before it decays", "[decay]")
+{
+    char *a = (char *)smalloc(100 * 1024);
+    char *guard = (char *)smalloc(10);
+    REQUIRE(a != nullptr);
+    sfree(a);
+    REQUIRE(_num_dirty_bytes() > 0);
+
+    char *b = (char *)smalloc(100 * 1024);
+    REQUIRE(b == a);
+    REQUIRE(_num_dirty_bytes() == 0);
+    usleep(2 * DECAY_MS * 1000);
+    REQUIRE(_num_muzzy_bytes() == 0);
+    REQUIRE(_num_purged_bytes() == 0);
+
+    sfree(b);
+    sfree(guard);
+}
+
+TEST_CASE("spurge", "[decay]")
+{
+    char *a = (char *)smalloc(100 * 1024);
+    char *guard = (char *)smalloc(10);
+    REQUIRE(a != nullptr);
+    std::memset(a, 'a', 100 * 1024);
+    sfree(a);
+    size_t dirty = _num_dirty_bytes();
+    REQUIRE(dirty > 0);
+
+    REQUIRE(spurge() == 1);
+    REQUIRE(_num_dirty_bytes() == 0);
+    REQUIRE(_num_purged_bytes() == dirty);
+    REQUIRE(resident_pages(a + PAGE_SIZE, 100 * 1024 - 2 * PAGE_SIZE) == 0);
+    REQUIRE(spurge() == 0);
+    verify_resident();
+
+    // purged pages read as zero
+    char *b = (char *)scalloc(100, 1024);
+    REQUIRE(b == a);
+    for (int i = 0; i < 100 * 1024; i++)
+    {
+        REQUIRE(b[i] == 0);
+    }
+    sfree(b);
+    sfree(guard);
+}
+
+TEST_CASE("sset_purge_decay", "[decay]")
+{
+    char *a = (char *)smalloc(100 * 1024);
+    char *b = (char *)smalloc(100 * 1024);
+    char *c = (char *)smalloc(100 * 1024);
+    char *guard = (char *)smalloc(10);
+    REQUIRE(a != nullptr);
+    REQUIRE(b != nullptr);
+    REQUIRE(c != nullptr);
+    REQUIRE(guard != nullptr);
+    sfree(a);
+    REQUIRE(_num_dirty_bytes() > 0);
+
+    // what is still decaying is purged, and sfree purges from now on
+    sset_purge_decay(0);
+    REQUIRE(_num_dirty_bytes() == 0);
+    size_t purged = _num_purged_bytes();
+    REQUIRE(purged > 0);
+    sfree(b);
+    REQUIRE(_num_dirty_bytes() == 0);
+    REQUIRE(_num_purged_bytes() > purged);
+
+    sset_purge_decay(DECAY_MS);
+    sfree(c);
+    REQUIRE(_num_dirty_bytes() > 0);
+    sfree(guard);
+}
+
+TEST_CASE("Merged free blocks decay once", "[decay]")
+{
+    char *a = (char *)smalloc(100 * 1024);
+    char *b = (char *)smalloc(100 * 1024);
+    char *guard = (char *)smalloc(10);
+    REQUIRE(a != nullptr);
+    REQUIRE(b != nullptr);
+    REQUIRE(guard != nullptr);
+    std::memset(a, 'a', 100 * 1024);
+    std::memset(b, 'b', 100 * 1024);
+
+    sfree(a);
+    size_t dirty_a = _num_dirty_bytes();
+    REQUIRE(dirty_a >= 100 * 1024 - 2 * PAGE_SIZE);
+
+    // b merges with a, so a's pages leave the dirty list and join it again with b's
+    sfree(b);
+    size_t dirty = _num_dirty_bytes();
+    REQUIRE(dirty >= dirty_a + 100 * 1024 - PAGE_SIZE);
+    REQUIRE(dirty <= dirty_a + 100 * 1024 + PAGE_SIZE);
+    REQUIRE(_num_muzzy_bytes() == 0);
+    verify_resident();
+
+    // counted once on the decay curve, the merged block overstays it right after the first step
+    for (int i = 0; i < DECAY_MS / 4 / 5 && _num_dirty_bytes() > 0; i++)
+    {
+        usleep(5 * 1000);
+        REQUIRE(_num_dirty_bytes() + _num_muzzy_bytes() + _num_purged_bytes() == dirty);
+    }
+    REQUIRE(_num_dirty_bytes() == 0);
+    REQUIRE(_num_muzzy_bytes() + _num_purged_bytes() == dirty);
+    verify_resident();
+
+    sfree(guard);
+}
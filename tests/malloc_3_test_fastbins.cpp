@@ -0,0 +1,139 @@
+#include "my_stdlib.h"
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstring>
+#include <unistd.h>
+#include <vector>
+
+#define FASTBIN_MAX_SIZE (512)
+#define FASTBIN_BUDGET (64 * 1024)
+
+TEST_CASE("Freed small blocks are binned", "[fastbins]")
+{
+    char *a = (char *)smalloc(100);
+    char *guard = (char *)smalloc(100);
+    REQUIRE(guard != nullptr);
+    sfree(a);
+    // a binned block is still used as far as the heap is concerned
+    REQUIRE(_num_allocated_blocks() == 2);
+    REQUIRE(_num_free_blocks() == 0);
+
+    // exact size reuse, no split
+    REQUIRE(smalloc(97) == a);
+    REQUIRE(_num_allocated_blocks() == 2);
+    sfree(a);
+    sfree(guard);
+}
+
+TEST_CASE("A miss consolidates the fast bins", "[fastbins]")
+{
+    char *a = (char *)smalloc(100);
+    char *b = (char *)smalloc(100);
+    char *c = (char *)smalloc(100);
+    char *guard = (char *)smalloc(100);
+    REQUIRE(guard != nullptr);
+    sfree(a);
+    sfree(b);
+    sfree(c);
+    REQUIRE(_num_free_blocks() == 0);
+
+    // nothing in the free list fits, so a, b and c are merged and reused
+    void *base = sbrk(0);
+    char *d = (char *)smalloc(300);
+    REQUIRE(d == a);
+    REQUIRE(sbrk(0) == base);
+    REQUIRE(_num_allocated_blocks() == 2);
+    REQUIRE(_num_free_blocks() == 0);
+    sfree(d);
+    sfree(guard);
+}
+
+TEST_CASE("Fast bins are bounded", "[fastbins]")
+{
+    size_t block_size = 100 + 4 + _size_meta_data();
+    const int count = FASTBIN_BUDGET / block_size + 1;
+    std::vector<char *> blocks(count);
+    for (int i = 0; i < count; i++)
+    {
+        blocks[i] = (char *)smalloc(100);
+        REQUIRE(blocks[i] != nullptr);
+    }
+    char *guard = (char *)smalloc(100);
+    REQUIRE(guard != nullptr);
+
+    // the last free goes over the budget and merges all of them
+    for (int i = 0; i < count; i++)
+    {
+        sfree(blocks[i]);
+    }
+    REQUIRE(_num_allocated_blocks() == 2);
+    REQUIRE(_num_free_blocks() == 1);
+    REQUIRE(_num_free_bytes() == count * block_size - _size_meta_data());
+    sfree(guard);
+}
+
+TEST_CASE("Large blocks skip the fast bins", "[fastbins]")
+{
+    char *a = (char *)smalloc(FASTBIN_MAX_SIZE);
+    char *guard = (char *)smalloc(100);
+    REQUIRE(guard != nullptr);
+    sfree(a);
+    REQUIRE(_num_free_blocks() == 1);
+    REQUIRE(_num_free_bytes() == FASTBIN_MAX_SIZE);
+    sfree(guard);
+}
+
+TEST_CASE("scalloc after the fast bins trimmed the heap", "[fastbins]")
+{
+    // a purged free block, two binned blocks and a free wilderness just under the trim threshold
+    char *a = (char *)smalloc(80 * 1024);
+    char *b = (char *)smalloc(200);
+    char *c = (char *)smalloc(100);
+    char *d = (char *)smalloc(131000);
+    REQUIRE(d != nullptr);
+    std::memset(a, 'a', 80 * 1024);
+    std::memset(d, 'd', 131000);
+    sfree(d);
+    sfree(a);
+    sfree(b);
+    sfree(c);
+
+    // consolidating merges c into the wilderness and trims it, then b joins a and the wilderness.
+    // the page of the trimmed wilderness' tip was never purged, though it is below the old top
+    char *e = (char *)scalloc(1, 100 * 1024);
+    REQUIRE(e != nullptr);
+    for (int i = 0; i < 100 * 1024; i++)
+    {
+        REQUIRE(e[i] == 0);
+    }
+    sfree(e);
+}
+
+TEST_CASE("Aligned slack of a binned block merges", "[fastbins]")
+{
+    // pick a's size so the binned block above it isn't 16 byte aligned
+    char *probe = (char *)smalloc(1000);
+    REQUIRE(probe != nullptr);
+    sfree(probe);
+    size_t a_size = ((uintptr_t)probe + 1000 + _size_meta_data()) % 16 == 0 ? 1008 : 1000;
+    char *a = (char *)smalloc(a_size);
+    char *b = (char *)smalloc(72); // the block smemalign(16, 1) asks the heap for
+    char *guard = (char *)smalloc(1000);
+    REQUIRE(a == probe);
+    REQUIRE(b == a + a_size + _size_meta_data());
+    REQUIRE(guard != nullptr);
+    sfree(b);
+    sfree(a);
+    size_t free_blocks = _num_free_blocks();
+    size_t free_bytes = _num_free_bytes();
+
+    // b comes back from its bin, and the slack below the aligned payload joins a
+    char *c = (char *)smemalign(16, 1);
+    REQUIRE(c != nullptr);
+    REQUIRE((uintptr_t)c % 16 == 0);
+    REQUIRE(c > b);
+    REQUIRE(_num_free_blocks() == free_blocks);
+    REQUIRE(_num_free_bytes() == free_bytes + (c - b));
+    sfree(c);
+    sfree(guard);
+}
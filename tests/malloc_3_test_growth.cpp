@@ -0,0 +1,136 @@
+#include "my_stdlib.h"
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstring>
+#include <unistd.h>
+
+// built with HEAP_GROWTH_GRANULE = GRANULE
+#define GRANULE (64 * 1024)
+
+#define verify_blocks(allocated_blocks, allocated_bytes, free_blocks, free_bytes)                                      \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        REQUIRE(_num_allocated_blocks() == (size_t)(allocated_blocks));                                                \
+        REQUIRE(_num_allocated_bytes() == (size_t)(allocated_bytes));                                                  \
+        REQUIRE(_num_free_blocks() == (size_t)(free_blocks));                                                          \
+        REQUIRE(_num_free_bytes() == (size_t)(free_bytes));                                                            \
+        REQUIRE(_num_meta_data_bytes() == _size_meta_data() * (allocated_blocks));                                     \
+    } while (0)
+
+#define verify_size(base)                                                                                              \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        void *after = sbrk(0);                                                                                         \
+        REQUIRE(_num_allocated_bytes() + _size_meta_data() * _num_allocated_blocks() ==                                \
+                (size_t)after - (size_t)base);                                                                         \
+    } while (0)
+
+TEST_CASE("The heap grows by whole granules", "[growth]")
+{
+    void *base = sbrk(0);
+    char *a = (char *)smalloc(96);
+    REQUIRE(a != nullptr);
+    REQUIRE((size_t)sbrk(0) % GRANULE == 0);
+    // what the heap grew by beyond the block is a free wilderness
+    verify_blocks(2, 96 + _num_free_bytes(), 1, _num_free_bytes());
+    REQUIRE(_num_free_bytes() < GRANULE);
+    verify_size(base);
+
+    // from the wilderness, without a syscall
+    size_t calls = _num_sbrk_calls();
+    char *b = (char *)smalloc(96);
+    REQUIRE(b == a + 96 + _size_meta_data());
+    REQUIRE(_num_sbrk_calls() == calls);
+    verify_blocks(3, 2 * 96 + _num_free_bytes(), 1, _num_free_bytes());
+    verify_size(base);
+
+    sfree(a);
+    sfree(b);
+    verify_blocks(1, _num_free_bytes(), 1, _num_free_bytes());
+    verify_size(base);
+}
+
+TEST_CASE("Many growing allocations make few syscalls", "[growth]")
+{
+    void *base = sbrk(0);
+    char *blocks[100];
+    size_t calls = 0;
+    for (int i = 0; i < 100; i++)
+    {
+        blocks[i] = (char *)smalloc(1000);
+        REQUIRE(blocks[i] != nullptr);
+        std::memset(blocks[i], 'a', 1000);
+        if (i == 0) // the heap is set up
+            calls = _num_sbrk_calls();
+    }
+    // 99 allocations, a syscall per granule boundary they cross
+    REQUIRE(_num_sbrk_calls() - calls <= 99 * (1000 + _size_meta_data()) / GRANULE + 1);
+    verify_size(base);
+    REQUIRE(_num_free_blocks() == 1);
+
+    for (int i = 0; i < 100; i++)
+    {
+        sfree(blocks[i]);
+    }
+    verify_size(base);
+}
+
+TEST_CASE("srealloc of the top block grows by granules", "[growth]")
+{
+    void *base = sbrk(0);
+    char *a = (char *)smalloc(1000);
+    REQUIRE(a != nullptr);
+    std::memset(a, 'a', 1000);
+    size_t calls = _num_sbrk_calls();
+    for (size_t size = 2000; size <= 100 * 1000; size += 1000)
+    {
+        char *b = (char *)srealloc(a, size);
+        REQUIRE(b == a);
+    }
+    REQUIRE(_num_sbrk_calls() - calls <= 100 * 1000 / GRANULE + 1);
+    for (int i = 0; i < 1000; i++)
+    {
+        REQUIRE(a[i] == 'a');
+    }
+    verify_blocks(2, 100 * 1000 + _num_free_bytes(), 1, _num_free_bytes());
+    verify_size(base);
+    sfree(a);
+}
+
+TEST_CASE("smalloc_batch grows by granules", "[growth]")
+{
+    void *base = sbrk(0);
+    void *ptrs[10];
+    REQUIRE(smalloc_batch(96, 10, ptrs) == 10);
+    REQUIRE((size_t)sbrk(0) % GRANULE == 0);
+    verify_blocks(11, 10 * 96 + _num_free_bytes(), 1, _num_free_bytes());
+    verify_size(base);
+    sfree_batch(ptrs, 10);
+    verify_size(base);
+}
+
+TEST_CASE("Syscall counters", "[growth]")
+{
+    char *a = (char *)smalloc(96);
+    REQUIRE(a != nullptr);
+    // wherever the break started, this leaves a whole page above a for strim to give back
+    char *c = (char *)smalloc(8 * 1024);
+    REQUIRE(c != nullptr);
+    size_t sbrk_calls = _num_sbrk_calls();
+    REQUIRE(sbrk_calls > 0);
+
+    size_t mmap_calls = _num_mmap_calls();
+    size_t munmap_calls = _num_munmap_calls();
+    char *b = (char *)smalloc(200 * 1024);
+    REQUIRE(b != nullptr);
+    REQUIRE(_num_mmap_calls() > mmap_calls);
+    REQUIRE(_num_munmap_calls() == munmap_calls);
+    sfree(b);
+    REQUIRE(_num_munmap_calls() == munmap_calls + 1);
+
+    // trimming the wilderness moves the top down
+    sfree(c);
+    sfree(a);
+    REQUIRE(strim(0) == 1);
+    REQUIRE(_num_sbrk_calls() == sbrk_calls + 1);
+}
@@ -0,0 +1,141 @@
+#include "my_stdlib.h"
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstring>
+#include <unistd.h>
+
+// built with USE_MMAP_CACHE
+#define MMAP_CACHE_BUDGET (32 * 1024 * 1024)
+#define MMAP_CACHE_MAX_AGE_MS 1000
+#define PAGE_SIZE 4096
+
+#define verify_blocks(allocated_blocks, allocated_bytes, free_blocks, free_bytes)                                      \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        REQUIRE(_num_allocated_blocks() == (size_t)(allocated_blocks));                                                \
+        REQUIRE(_num_allocated_bytes() == (size_t)(allocated_bytes));                                                  \
+        REQUIRE(_num_free_blocks() == (size_t)(free_blocks));                                                          \
+        REQUIRE(_num_free_bytes() == (size_t)(free_bytes));                                                            \
+        REQUIRE(_num_meta_data_bytes() == _size_meta_data() * (allocated_blocks));                                     \
+    } while (0)
+
+// the pages an mmapped block of this payload takes
+static size_t pages_of(size_t size)
+{
+    return (size + _size_meta_data() + PAGE_SIZE - 1) & ~(size_t)(PAGE_SIZE - 1);
+}
+
+TEST_CASE("Freed mappings are reused", "[mmap_cache]")
+{
+    char *a = (char *)smalloc(200 * 1024);
+    REQUIRE(a != nullptr);
+    REQUIRE(_num_mmap_cache_hits() == 0);
+    REQUIRE(_num_mmap_cache_misses() == 1);
+    verify_blocks(1, 200 * 1024, 0, 0);
+
+    sfree(a);
+    verify_blocks(0, 0, 0, 0);
+    REQUIRE(_num_mmap_cached_bytes() == pages_of(200 * 1024));
+
+    char *b = (char *)smalloc(200 * 1024);
+    REQUIRE(b == a);
+    REQUIRE(_num_mmap_cache_hits() == 1);
+    REQUIRE(_num_mmap_cache_misses() == 1);
+    REQUIRE(_num_mmap_cached_bytes() == 0);
+    verify_blocks(1, 200 * 1024, 0, 0);
+    std::memset(b, 'b', 200 * 1024);
+    sfree(b);
+}
+
+TEST_CASE("A larger region is split", "[mmap_cache]")
+{
+    char *a = (char *)smalloc(400 * 1024);
+    REQUIRE(a != nullptr);
+    sfree(a);
+
+    char *b = (char *)smalloc(150 * 1024);
+    REQUIRE(b == a);
+    REQUIRE(_num_mmap_cached_bytes() == pages_of(400 * 1024) - pages_of(150 * 1024));
+
+    // the tail is a region of its own
+    char *c = (char *)smalloc(200 * 1024);
+    REQUIRE(c == b + pages_of(150 * 1024));
+    REQUIRE(_num_mmap_cache_hits() == 2);
+    verify_blocks(2, 350 * 1024, 0, 0);
+    std::memset(b, 'b', 150 * 1024);
+    std::memset(c, 'c', 200 * 1024);
+
+    sfree(b);
+    sfree(c);
+    REQUIRE(_num_mmap_cached_bytes() == pages_of(400 * 1024));
+}
+
+TEST_CASE("scalloc of a cached region", "[mmap_cache]")
+{
+    char *a = (char *)smalloc(200 * 1024);
+    REQUIRE(a != nullptr);
+    std::memset(a, 'a', 200 * 1024);
+    sfree(a);
+
+    char *b = (char *)scalloc(200, 1024);
+    REQUIRE(b == a);
+    for (int i = 0; i < 200 * 1024; i++)
+    {
+        REQUIRE(b[i] == 0);
+    }
+    sfree(b);
+}
+
+TEST_CASE("srealloc to an mmapped block", "[mmap_cache]")
+{
+    char *a = (char *)smalloc(200 * 1024);
+    REQUIRE(a != nullptr);
+    sfree(a);
+
+    char *b = (char *)smalloc(100);
+    char *guard = (char *)smalloc(10); // so b can't grow in place
+    REQUIRE(b != nullptr);
+    REQUIRE(guard != nullptr);
+    std::memset(b, 'b', 100);
+    char *c = (char *)srealloc(b, 200 * 1024);
+    REQUIRE(c == a);
+    REQUIRE(_num_mmap_cache_hits() == 1);
+    for (int i = 0; i < 100; i++)
+    {
+        REQUIRE(c[i] == 'b');
+    }
+    sfree(c);
+    sfree(guard);
+}
+
+TEST_CASE("Cache eviction", "[mmap_cache]")
+{
+    // too large to be cached
+    char *a = (char *)smalloc(MMAP_CACHE_BUDGET / 4 + PAGE_SIZE);
+    REQUIRE(a != nullptr);
+    sfree(a);
+    REQUIRE(_num_mmap_cached_bytes() == 0);
+
+    // over the budget, the oldest are unmapped
+    const size_t size = 7 * 1024 * 1024;
+    char *blocks[5];
+    for (int i = 0; i < 5; i++)
+    {
+        blocks[i] = (char *)smalloc(size);
+        REQUIRE(blocks[i] != nullptr);
+    }
+    for (int i = 0; i < 5; i++)
+    {
+        sfree(blocks[i]);
+    }
+    REQUIRE(_num_mmap_cached_bytes() == 4 * pages_of(size));
+
+    // too old
+    usleep((MMAP_CACHE_MAX_AGE_MS + 100) * 1000);
+    char *b = (char *)smalloc(size);
+    REQUIRE(b != nullptr);
+    REQUIRE(_num_mmap_cached_bytes() == 0);
+    REQUIRE(_num_mmap_cache_hits() == 0);
+    sfree(b);
+    REQUIRE(_num_mmap_cached_bytes() == pages_of(size));
+}
@@ -0,0 +1,44 @@
+#include "my_stdlib.h"
+#include <catch2/catch_test_macros.hpp>
+
+#include <new>
+
+#define MMAP_THRESHOLD (128 * 1024)
+
+struct Large
+{
+    char data[MMAP_THRESHOLD];
+};
+
+TEST_CASE("new and delete use smalloc and sfree", "[new]")
+{
+    size_t before = _num_allocated_bytes();
+    int *x = new int(5);
+    Large *large = new Large;
+    large->data[MMAP_THRESHOLD - 1] = 'x';
+    size_t during = _num_allocated_bytes();
+    delete large; // sized delete
+    size_t after = _num_allocated_bytes();
+    delete x;
+
+    REQUIRE(during >= before + MMAP_THRESHOLD);
+    REQUIRE(after + MMAP_THRESHOLD == during);
+}
+
+TEST_CASE("Arrays and nothrow new", "[new]")
+{
+    size_t before = _num_allocated_bytes();
+    char *array = new char[2 * MMAP_THRESHOLD];
+    array[2 * MMAP_THRESHOLD - 1] = 'x';
+    size_t during = _num_allocated_bytes();
+    delete[] array;
+    size_t after = _num_allocated_bytes();
+
+    REQUIRE(during == before + 2 * MMAP_THRESHOLD);
+    REQUIRE(after == before);
+
+    int *x = new (std::nothrow) int(7);
+    REQUIRE(x != nullptr);
+    REQUIRE(*x == 7);
+    delete x;
+}
@@ -0,0 +1,138 @@
+#include "my_stdlib.h"
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// built with USE_PURGE
+#define PURGE_MIN_SIZE (64 * 1024)
+#define PAGE_SIZE 4096
+
+#define verify_resident()                                                                                              \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        REQUIRE(_num_resident_bytes() ==                                                                               \
+                _num_allocated_bytes() + _size_meta_data() * _num_allocated_blocks() - _num_purged_bytes());           \
+    } while (0)
+
+// how many of the whole pages in [p, p + size) are in memory
+static size_t resident_pages(void *p, size_t size)
+{
+    uintptr_t start = ((uintptr_t)p + PAGE_SIZE - 1) & ~(uintptr_t)(PAGE_SIZE - 1);
+    uintptr_t end = ((uintptr_t)p + size) & ~(uintptr_t)(PAGE_SIZE - 1);
+    if (end <= start)
+        return 0;
+    unsigned char vec[(end - start) / PAGE_SIZE];
+    REQUIRE(mincore((void *)start, end - start, vec) == 0);
+    size_t count = 0;
+    for (size_t i = 0; i < (end - start) / PAGE_SIZE; i++)
+        count += vec[i] & 1;
+    return count;
+}
+
+TEST_CASE("Large free blocks are purged", "[purge]")
+{
+    char *a = (char *)smalloc(100 * 1024);
+    char *guard = (char *)smalloc(10); // keeps a from being the wilderness
+    REQUIRE(a != nullptr);
+    REQUIRE(guard != nullptr);
+    std::memset(a, 'a', 100 * 1024);
+    REQUIRE(_num_purged_bytes() == 0);
+    REQUIRE(resident_pages(a, 100 * 1024) > 0);
+    verify_resident();
+
+    sfree(a);
+    // all but the pages with the metaData and the tip
+    REQUIRE(_num_purged_bytes() >= 100 * 1024 - 2 * PAGE_SIZE);
+    REQUIRE(_num_purged_bytes() <= 100 * 1024);
+    REQUIRE(resident_pages(a + PAGE_SIZE, 100 * 1024 - 2 * PAGE_SIZE) == 0);
+    REQUIRE(_num_free_bytes() == 100 * 1024);
+    verify_resident();
+
+    // reused, so it's no longer purged
+    char *b = (char *)smalloc(100 * 1024);
+    REQUIRE(b == a);
+    REQUIRE(_num_purged_bytes() == 0);
+    verify_resident();
+
+    sfree(b);
+    sfree(guard);
+}
+
+TEST_CASE("Small free blocks are not purged", "[purge]")
+{
+    char *a = (char *)smalloc(40 * 1024);
+    char *b = (char *)smalloc(40 * 1024);
+    char *guard = (char *)smalloc(10);
+    REQUIRE(a != nullptr);
+    REQUIRE(b != nullptr);
+    REQUIRE(guard != nullptr);
+    std::memset(a, 'a', 40 * 1024);
+    std::memset(b, 'b', 40 * 1024);
+    sfree(a);
+    REQUIRE(_num_purged_bytes() == 0);
+    verify_resident();
+
+    // merged with its free neighbour, the block is large enough
+    sfree(b);
+    REQUIRE(_num_free_blocks() == 1);
+    REQUIRE(_num_purged_bytes() >= 80 * 1024 - 2 * PAGE_SIZE);
+    verify_resident();
+    sfree(guard);
+}
+
+TEST_CASE("scalloc of a purged block", "[purge]")
+{
+    char *a = (char *)smalloc(100 * 1024);
+    char *guard = (char *)smalloc(10);
+    REQUIRE(a != nullptr);
+    std::memset(a, 'a', 100 * 1024);
+    sfree(a);
+    REQUIRE(_num_purged_bytes() > 0);
+
+    char *b = (char *)scalloc(20, 1024);
+    REQUIRE(b == a);
+    for (int i = 0; i < 20 * 1024; i++)
+    {
+        REQUIRE(b[i] == 0);
+    }
+    // what is left of the block was split off and is still purged
+    REQUIRE(_num_purged_bytes() >= 80 * 1024 - 2 * PAGE_SIZE);
+    verify_resident();
+
+    // a purged page that scalloc would have cleared is still not in memory
+    sfree(b);
+    char *c = (char *)scalloc(100, 1024);
+    REQUIRE(c == a);
+    REQUIRE(resident_pages(c + PAGE_SIZE, 100 * 1024 - 2 * PAGE_SIZE) <= 1);
+    for (int i = 0; i < 100 * 1024; i++)
+    {
+        REQUIRE(c[i] == 0);
+    }
+    sfree(c);
+    sfree(guard);
+}
+
+TEST_CASE("Purged wilderness", "[purge]")
+{
+    char *a = (char *)smalloc(100 * 1024);
+    REQUIRE(a != nullptr);
+    std::memset(a, 'a', 100 * 1024);
+    sfree(a);
+    REQUIRE(_num_purged_bytes() >= 100 * 1024 - 2 * PAGE_SIZE);
+    verify_resident();
+
+    // grows the purged wilderness
+    char *b = (char *)scalloc(1, 120 * 1024);
+    REQUIRE(b == a);
+    REQUIRE(_num_purged_bytes() == 0);
+    REQUIRE(resident_pages(b + PAGE_SIZE, 100 * 1024 - 2 * PAGE_SIZE) == 0);
+    for (int i = 0; i < 120 * 1024; i++)
+    {
+        REQUIRE(b[i] == 0);
+    }
+    verify_resident();
+    sfree(b);
+}
@@ -0,0 +1,102 @@
+#include "my_stdlib.h"
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#define REMOTE_ARENAS (4)
+
+TEST_CASE("Remote free returns the block to its owner", "[remote_free]")
+{
+    char *a = (char *)smalloc(100);
+    REQUIRE(a != nullptr);
+    std::thread other([a]() { sfree(a); });
+    other.join();
+
+    // the statistics drain the pending frees, so they are exact
+    REQUIRE(_num_allocated_blocks() == 1);
+    REQUIRE(_num_free_blocks() == 1);
+    REQUIRE(_num_free_bytes() == 104);
+
+    // the owner reuses the block on its next allocation
+    char *b = (char *)smalloc(100);
+    REQUIRE(b == a);
+    sfree(b);
+}
+
+TEST_CASE("Pending remote frees are drained by the owner's smalloc", "[remote_free]")
+{
+    const int count = 64;
+    std::vector<char *> blocks;
+    for (int i = 0; i < count; i++)
+    {
+        blocks.push_back((char *)smalloc(200));
+        REQUIRE(blocks.back() != nullptr);
+    }
+    std::thread other([&blocks]() {
+        for (char *block : blocks)
+        {
+            sfree(block);
+        }
+    });
+    other.join();
+
+    // all of them are free again, and reused before the heap grows
+    for (int i = 0; i < count; i++)
+    {
+        char *block = (char *)smalloc(200);
+        REQUIRE(block != nullptr);
+        REQUIRE(std::find(blocks.begin(), blocks.end(), block) != blocks.end());
+        blocks[i] = block;
+    }
+    for (char *block : blocks)
+    {
+        sfree(block);
+    }
+}
+
+TEST_CASE("Producers and consumers", "[remote_free]")
+{
+    const int pairs = REMOTE_ARENAS / 2;
+    const int count = 20000;
+    std::atomic<int> errors(0);
+    std::vector<std::thread> threads;
+    std::vector<std::atomic<char *>> slots(pairs * count);
+    for (auto &slot : slots)
+    {
+        slot = nullptr;
+    }
+    for (int p = 0; p < pairs; p++)
+    {
+        threads.emplace_back([p, &slots, &errors]() {
+            for (int i = 0; i < count; i++)
+            {
+                char *block = (char *)smalloc(16 + i % 500);
+                if (!block)
+                    errors++;
+                else
+                    block[0] = (char)i;
+                slots[p * count + i] = block;
+            }
+        });
+        threads.emplace_back([p, &slots, &errors]() {
+            for (int i = 0; i < count; i++)
+            {
+                char *block;
+                while (!(block = slots[p * count + i].load()))
+                    std::this_thread::yield();
+                if (block[0] != (char)i)
+                    errors++;
+                sfree(block);
+            }
+        });
+    }
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+    REQUIRE(errors == 0);
+    REQUIRE(_num_free_bytes() == _num_allocated_bytes());
+}
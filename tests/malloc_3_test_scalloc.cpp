@@ -1,6 +1,7 @@
 #include "my_stdlib.h"
 #include <catch2/catch_test_macros.hpp>
 
+#include <cstring>
 #include <unistd.h>
 
 #define MAX_ALLOCATION_SIZE (1e8)
@@ -202,3 +203,45 @@ TEST_CASE("scalloc Max size both", "[malloc3]")
     verify_blocks(0, 0, 0, 0);
     verify_size_with_large_blocks(base, 0);
 }
+
+TEST_CASE("scalloc overflow", "[malloc3]")
+{
+    verify_blocks(0, 0, 0, 0);
+    void *base = sbrk(0);
+    // num * size wraps around to 16
+    char *a = (char *)scalloc((size_t)(-1) / 16 + 2, 16);
+    REQUIRE(a == nullptr);
+    a = (char *)scalloc(16, (size_t)(-1) / 16 + 2);
+    REQUIRE(a == nullptr);
+    REQUIRE(sbrk(0) == base);
+    verify_blocks(0, 0, 0, 0);
+}
+
+TEST_CASE("scalloc of a grown wilderness", "[malloc3]")
+{
+    // the start of the block is old (dirty) heap, the rest is new
+    char *a = (char *)smalloc(1000);
+    REQUIRE(a != nullptr);
+    std::memset(a, 'a', 1000);
+    sfree(a);
+
+    size_t size = MMAP_THRESHOLD / 2;
+    char *b = (char *)scalloc(size, 1);
+    REQUIRE(b == a);
+    for (size_t i = 0; i < size; i++)
+    {
+        REQUIRE(b[i] == 0);
+    }
+    verify_blocks(1, size, 0, 0);
+
+    // and reused heap is cleared all the way
+    std::memset(b, 'b', size);
+    sfree(b);
+    char *c = (char *)scalloc(size / 8, 8);
+    REQUIRE(c == b);
+    for (size_t i = 0; i < size; i++)
+    {
+        REQUIRE(c[i] == 0);
+    }
+    sfree(c);
+}
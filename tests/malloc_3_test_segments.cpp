@@ -0,0 +1,211 @@
+#include "my_stdlib.h"
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstring>
+#include <unistd.h>
+
+// built with USE_SEGMENTS and ARENA_SEGMENT_SIZE = SEGMENT_SIZE
+#define SEGMENT_SIZE (1024 * 1024)
+#define BLOCK_SIZE (100 * 1024)
+#define BLOCKS_PER_SEGMENT 10 // of BLOCK_SIZE, with their metaData
+#define LARGER_SIZE (125 * 1024) // more than what these leave of a segment, still on the heap
+#define PAGE_SIZE 4096
+
+#define verify_blocks(allocated_blocks, allocated_bytes, free_blocks, free_bytes)                                      \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        REQUIRE(_num_allocated_blocks() == (size_t)(allocated_blocks));                                                \
+        REQUIRE(_num_allocated_bytes() == (size_t)(allocated_bytes));                                                  \
+        REQUIRE(_num_free_blocks() == (size_t)(free_blocks));                                                          \
+        REQUIRE(_num_free_bytes() == (size_t)(free_bytes));                                                            \
+        REQUIRE(_num_meta_data_bytes() == _size_meta_data() * (allocated_blocks));                                     \
+    } while (0)
+
+TEST_CASE("The heap doesn't move the program break", "[segments]")
+{
+    void *base = sbrk(0);
+    char *blocks[4];
+    for (int i = 0; i < 4; i++)
+    {
+        blocks[i] = (char *)smalloc(BLOCK_SIZE);
+        REQUIRE(blocks[i] != nullptr);
+        std::memset(blocks[i], 'a' + i, BLOCK_SIZE);
+    }
+    REQUIRE(sbrk(0) == base);
+    REQUIRE(_num_heap_segments() == 1);
+    verify_blocks(4, 4 * BLOCK_SIZE, 0, 0);
+    REQUIRE(blocks[1] == blocks[0] + BLOCK_SIZE + _size_meta_data());
+
+    for (int i = 0; i < 4; i++)
+    {
+        sfree(blocks[i]);
+    }
+    verify_blocks(1, 4 * BLOCK_SIZE + 3 * _size_meta_data(), 1, 4 * BLOCK_SIZE + 3 * _size_meta_data());
+    REQUIRE(sbrk(0) == base);
+}
+
+TEST_CASE("A full segment is followed by a new one", "[segments]")
+{
+    const int count = 2 * BLOCKS_PER_SEGMENT;
+    char *blocks[count];
+    for (int i = 0; i < count; i++)
+    {
+        blocks[i] = (char *)smalloc(BLOCK_SIZE);
+        REQUIRE(blocks[i] != nullptr);
+        std::memset(blocks[i], 'a' + i, BLOCK_SIZE);
+    }
+    REQUIRE(_num_heap_segments() == 2);
+    verify_blocks(count, count * BLOCK_SIZE, 0, 0);
+    for (int i = 0; i < count; i++)
+    {
+        for (int j = 0; j < BLOCK_SIZE; j += 512)
+        {
+            REQUIRE(blocks[i][j] == 'a' + i);
+        }
+    }
+
+    // the free blocks of a segment don't merge with the next one
+    for (int i = 0; i < count; i++)
+    {
+        sfree(blocks[i]);
+    }
+    size_t segment_bytes = BLOCKS_PER_SEGMENT * BLOCK_SIZE + (BLOCKS_PER_SEGMENT - 1) * _size_meta_data();
+    verify_blocks(2, 2 * segment_bytes, 2, 2 * segment_bytes);
+
+    // and are reused before the heap grows again
+    for (int i = 0; i < count; i++)
+    {
+        blocks[i] = (char *)smalloc(BLOCK_SIZE);
+        REQUIRE(blocks[i] != nullptr);
+    }
+    REQUIRE(_num_heap_segments() == 2);
+    verify_blocks(count, count * BLOCK_SIZE, 0, 0);
+    for (int i = 0; i < count; i++)
+    {
+        sfree(blocks[i]);
+    }
+}
+
+TEST_CASE("The free wilderness of a full segment", "[segments]")
+{
+    char *blocks[BLOCKS_PER_SEGMENT];
+    for (int i = 0; i < BLOCKS_PER_SEGMENT; i++)
+    {
+        blocks[i] = (char *)smalloc(BLOCK_SIZE);
+        REQUIRE(blocks[i] != nullptr);
+    }
+    sfree(blocks[BLOCKS_PER_SEGMENT - 1]);
+    verify_blocks(BLOCKS_PER_SEGMENT, BLOCKS_PER_SEGMENT * BLOCK_SIZE, 1, BLOCK_SIZE);
+
+    // too large for what is left of the segment- the wilderness becomes a free block
+    char *a = (char *)smalloc(LARGER_SIZE);
+    REQUIRE(a != nullptr);
+    REQUIRE(_num_heap_segments() == 2);
+    verify_blocks(BLOCKS_PER_SEGMENT + 1, BLOCKS_PER_SEGMENT * BLOCK_SIZE + LARGER_SIZE, 1, BLOCK_SIZE);
+
+    char *b = (char *)smalloc(BLOCK_SIZE);
+    REQUIRE(b == blocks[BLOCKS_PER_SEGMENT - 1]);
+    verify_blocks(BLOCKS_PER_SEGMENT + 1, BLOCKS_PER_SEGMENT * BLOCK_SIZE + LARGER_SIZE, 0, 0);
+
+    sfree(a);
+    sfree(b);
+    for (int i = 0; i < BLOCKS_PER_SEGMENT - 1; i++)
+    {
+        sfree(blocks[i]);
+    }
+}
+
+TEST_CASE("srealloc of the top block of a full segment", "[segments]")
+{
+    char *blocks[BLOCKS_PER_SEGMENT];
+    for (int i = 0; i < BLOCKS_PER_SEGMENT; i++)
+    {
+        blocks[i] = (char *)smalloc(BLOCK_SIZE);
+        REQUIRE(blocks[i] != nullptr);
+    }
+    char *top = blocks[BLOCKS_PER_SEGMENT - 1];
+    std::memset(top, 't', BLOCK_SIZE);
+
+    // can't grow in place, moves to a new segment
+    char *a = (char *)srealloc(top, LARGER_SIZE);
+    REQUIRE(a != nullptr);
+    REQUIRE(a != top);
+    REQUIRE(_num_heap_segments() == 2);
+    for (int i = 0; i < BLOCK_SIZE; i++)
+    {
+        REQUIRE(a[i] == 't');
+    }
+    verify_blocks(BLOCKS_PER_SEGMENT + 1, (BLOCKS_PER_SEGMENT - 1) * BLOCK_SIZE + LARGER_SIZE + BLOCK_SIZE, 1,
+                  BLOCK_SIZE);
+
+    sfree(a);
+    for (int i = 0; i < BLOCKS_PER_SEGMENT - 1; i++)
+    {
+        sfree(blocks[i]);
+    }
+}
+
+TEST_CASE("smalloc_batch larger than a segment", "[segments]")
+{
+    char *a = (char *)smalloc(BLOCK_SIZE);
+    REQUIRE(a != nullptr);
+    const int count = 3 * BLOCKS_PER_SEGMENT / 2;
+    void *ptrs[count];
+    REQUIRE(smalloc_batch(BLOCK_SIZE, count, ptrs) == count);
+    REQUIRE(_num_heap_segments() == 2);
+    verify_blocks(count + 1, (count + 1) * BLOCK_SIZE, 0, 0);
+    for (int i = 0; i < count; i++)
+    {
+        std::memset(ptrs[i], 'a', BLOCK_SIZE);
+    }
+    sfree_batch(ptrs, count);
+    sfree(a);
+}
+
+TEST_CASE("scalloc of a block in an older segment", "[segments]")
+{
+    char *blocks[BLOCKS_PER_SEGMENT];
+    for (int i = 0; i < BLOCKS_PER_SEGMENT; i++)
+    {
+        blocks[i] = (char *)smalloc(BLOCK_SIZE);
+        REQUIRE(blocks[i] != nullptr);
+        std::memset(blocks[i], 'a', BLOCK_SIZE);
+    }
+    char *a = (char *)smalloc(BLOCK_SIZE);
+    REQUIRE(a != nullptr);
+    REQUIRE(_num_heap_segments() == 2);
+    std::memset(a, 'a', BLOCK_SIZE);
+
+    // dirty, wherever the older segment is mapped
+    sfree(blocks[0]);
+    char *b = (char *)scalloc(BLOCK_SIZE, 1);
+    REQUIRE(b == blocks[0]);
+    for (int i = 0; i < BLOCK_SIZE; i++)
+    {
+        REQUIRE(b[i] == 0);
+    }
+
+    sfree(a);
+    sfree(b);
+    for (int i = 1; i < BLOCKS_PER_SEGMENT; i++)
+    {
+        sfree(blocks[i]);
+    }
+}
+
+TEST_CASE("Other sbrk users", "[segments]")
+{
+    char *a = (char *)smalloc(BLOCK_SIZE);
+    REQUIRE(a != nullptr);
+    void *other = sbrk(PAGE_SIZE);
+    REQUIRE(other != (void *)(-1));
+    char *b = (char *)smalloc(BLOCK_SIZE);
+    REQUIRE(b == a + BLOCK_SIZE + _size_meta_data());
+    verify_blocks(2, 2 * BLOCK_SIZE, 0, 0);
+
+    sfree(a);
+    sfree(b);
+    verify_blocks(1, 2 * BLOCK_SIZE + _size_meta_data(), 1, 2 * BLOCK_SIZE + _size_meta_data());
+    REQUIRE(strim(0) == 1);
+    REQUIRE(sbrk(-PAGE_SIZE) != (void *)(-1));
+}
@@ -0,0 +1,56 @@
+#include "my_stdlib.h"
+#include <catch2/catch_test_macros.hpp>
+
+#include <unistd.h>
+
+#define MMAP_THRESHOLD (128 * 1024)
+
+#define verify_blocks(allocated_blocks, allocated_bytes, free_blocks, free_bytes)                                      \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        REQUIRE(_num_allocated_blocks() == (size_t)(allocated_blocks));                                                \
+        REQUIRE(_num_allocated_bytes() == (size_t)(allocated_bytes));                                                  \
+        REQUIRE(_num_free_blocks() == (size_t)(free_blocks));                                                          \
+        REQUIRE(_num_free_bytes() == (size_t)(free_bytes));                                                            \
+        REQUIRE(_num_meta_data_bytes() == _size_meta_data() * (allocated_blocks));                                     \
+    } while (0)
+
+TEST_CASE("Sized free", "[sized]")
+{
+    char *a = (char *)smalloc(100);
+    char *b = (char *)smalloc(100);
+    char *c = (char *)smalloc(100);
+    REQUIRE(c != nullptr);
+    verify_blocks(3, 3 * 104, 0, 0);
+
+    sfree_sized(a, 100);
+    verify_blocks(3, 3 * 104, 1, 104);
+
+    // merges just like sfree
+    sfree_sized(b, 97);
+    verify_blocks(2, 3 * 104 + _size_meta_data(), 1, 2 * 104 + _size_meta_data());
+    sfree_sized(c, 100);
+    verify_blocks(1, 3 * 104 + 2 * _size_meta_data(), 1, 3 * 104 + 2 * _size_meta_data());
+    sfree_sized(nullptr, 100);
+}
+
+TEST_CASE("Sized free of large blocks", "[sized]")
+{
+    char *a = (char *)smalloc(MMAP_THRESHOLD);
+    REQUIRE(a != nullptr);
+    verify_blocks(1, MMAP_THRESHOLD, 0, 0);
+    sfree_sized(a, MMAP_THRESHOLD);
+    verify_blocks(0, 0, 0, 0);
+}
+
+TEST_CASE("Sized free after srealloc", "[sized]")
+{
+    char *a = (char *)smalloc(100);
+    REQUIRE(a != nullptr);
+    // the wilderness grows in place past the mmap threshold
+    char *b = (char *)srealloc(a, MMAP_THRESHOLD + 8);
+    REQUIRE(b == a);
+    verify_blocks(1, MMAP_THRESHOLD + 8, 0, 0);
+    sfree_sized(b, MMAP_THRESHOLD + 8);
+    verify_blocks(1, MMAP_THRESHOLD + 8, 1, MMAP_THRESHOLD + 8);
+}
@@ -0,0 +1,124 @@
+#include "my_stdlib.h"
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <unistd.h>
+
+#define MIN_SPLIT_SIZE (128)
+#define SLAB_SIZE (4096)
+
+#define verify_slabs(slabs, objects, bytes)                                                                            \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        REQUIRE(_num_slabs() == (size_t)(slabs));                                                                      \
+        REQUIRE(_num_slab_objects() == (size_t)(objects));                                                             \
+        REQUIRE(_num_slab_bytes() == (size_t)(bytes));                                                                 \
+    } while (0)
+
+TEST_CASE("Small objects come from slabs", "[slab]")
+{
+    void *base = sbrk(0);
+    char *a = (char *)smalloc(10);
+    char *b = (char *)smalloc(16);
+    REQUIRE(a != nullptr);
+    REQUIRE(b != nullptr);
+    // same size class, same slab, no metaData in between
+    REQUIRE(b - a == 16);
+    REQUIRE(((uintptr_t)a & ~(uintptr_t)(SLAB_SIZE - 1)) == ((uintptr_t)b & ~(uintptr_t)(SLAB_SIZE - 1)));
+    REQUIRE(sbrk(0) == base);
+    REQUIRE(_num_allocated_blocks() == 0);
+    verify_slabs(1, 2, 32);
+
+    sfree(a);
+    verify_slabs(1, 1, 16);
+    sfree(b);
+    verify_slabs(0, 0, 0);
+}
+
+TEST_CASE("Size classes use separate slabs", "[slab]")
+{
+    char *a = (char *)smalloc(8);
+    char *b = (char *)smalloc(64);
+    char *c = (char *)smalloc(MIN_SPLIT_SIZE - 1);
+    REQUIRE(a != nullptr);
+    REQUIRE(b != nullptr);
+    REQUIRE(c != nullptr);
+    verify_slabs(3, 3, 8 + 64 + MIN_SPLIT_SIZE);
+
+    sfree(a);
+    sfree(b);
+    sfree(c);
+    verify_slabs(0, 0, 0);
+}
+
+TEST_CASE("Freed objects are reused", "[slab]")
+{
+    char *a = (char *)smalloc(40);
+    char *b = (char *)smalloc(40);
+    sfree(a);
+    char *c = (char *)smalloc(33);
+    REQUIRE(c == a);
+    sfree(b);
+    sfree(c);
+
+    // an empty slab is recycled for another size class
+    char *d = (char *)smalloc(100);
+    REQUIRE(((uintptr_t)d & ~(uintptr_t)(SLAB_SIZE - 1)) == ((uintptr_t)a & ~(uintptr_t)(SLAB_SIZE - 1)));
+    verify_slabs(1, 1, 104);
+    sfree(d);
+}
+
+TEST_CASE("Full slab", "[slab]")
+{
+    const int count = SLAB_SIZE / 64;
+    char *objects[count];
+    for (int i = 0; i < count; i++)
+    {
+        objects[i] = (char *)smalloc(64);
+        REQUIRE(objects[i] != nullptr);
+    }
+    // the slab header takes room, so the last objects spill to a second slab
+    verify_slabs(2, count, count * 64);
+    for (int i = 0; i < count; i++)
+    {
+        sfree(objects[i]);
+    }
+    verify_slabs(0, 0, 0);
+}
+
+TEST_CASE("Large objects skip the slabs", "[slab]")
+{
+    void *base = sbrk(0);
+    char *a = (char *)smalloc(MIN_SPLIT_SIZE);
+    REQUIRE(a != nullptr);
+    REQUIRE(_num_allocated_blocks() == 1);
+    REQUIRE((size_t)sbrk(0) - (size_t)base == MIN_SPLIT_SIZE + _size_meta_data());
+    verify_slabs(0, 0, 0);
+    sfree(a);
+}
+
+TEST_CASE("srealloc slab objects", "[slab]")
+{
+    char *a = (char *)smalloc(20);
+    std::memset(a, 'a', 20);
+    REQUIRE(srealloc(a, 24) == a);
+
+    char *b = (char *)srealloc(a, 60);
+    REQUIRE(b != a);
+    for (int i = 0; i < 20; i++)
+    {
+        REQUIRE(b[i] == 'a');
+    }
+    verify_slabs(1, 1, 64);
+
+    char *c = (char *)srealloc(b, 1000);
+    REQUIRE(c != nullptr);
+    for (int i = 0; i < 20; i++)
+    {
+        REQUIRE(c[i] == 'a');
+    }
+    verify_slabs(0, 0, 0);
+    REQUIRE(_num_allocated_blocks() == 1);
+    sfree(c);
+}
@@ -685,7 +685,7 @@ TEST_CASE("srealloc case fii", "[malloc3]")
     verify_size(base);
 }
 
-TEST_CASE("srealloc case g", "[malloc3]")
+TEST_CASE("srealloc case g", "[malloc3][best_fit]")
 {
     verify_blocks(0, 0, 0, 0);
     void *base = sbrk(0);
@@ -774,3 +774,49 @@ TEST_CASE("srealloc case h", "[malloc3]")
     verify_blocks(1, blocks_size + pad_size + 5 * _size_meta_data(), 1, blocks_size + pad_size + 5 * _size_meta_data());
     verify_size(base);
 }
+
+TEST_CASE("srealloc mmap grow", "[malloc3]")
+{
+    verify_blocks(0, 0, 0, 0);
+    void *base = sbrk(0);
+    char *a = (char *)smalloc(MMAP_THRESHOLD);
+    REQUIRE(a != nullptr);
+    populate_array(a, MMAP_THRESHOLD);
+
+    char *b = (char *)srealloc(a, 8 * MMAP_THRESHOLD);
+    REQUIRE(b != nullptr);
+    verify_blocks(1, 8 * MMAP_THRESHOLD, 0, 0);
+    verify_size_with_large_blocks(base, 0);
+    validate_array(b, MMAP_THRESHOLD);
+    populate_array(b, 8 * MMAP_THRESHOLD);
+
+    char *c = (char *)srealloc(b, 64 * MMAP_THRESHOLD);
+    REQUIRE(c != nullptr);
+    verify_blocks(1, 64 * MMAP_THRESHOLD, 0, 0);
+    verify_size_with_large_blocks(base, 0);
+    validate_array(c, 8 * MMAP_THRESHOLD);
+
+    sfree(c);
+    verify_blocks(0, 0, 0, 0);
+    verify_size_with_large_blocks(base, 0);
+}
+
+TEST_CASE("srealloc mmap shrink", "[malloc3]")
+{
+    verify_blocks(0, 0, 0, 0);
+    void *base = sbrk(0);
+    char *a = (char *)smalloc(8 * MMAP_THRESHOLD);
+    REQUIRE(a != nullptr);
+    populate_array(a, 8 * MMAP_THRESHOLD);
+
+    // the tail is given back in place
+    char *b = (char *)srealloc(a, MMAP_THRESHOLD + 8);
+    REQUIRE(b == a);
+    verify_blocks(1, MMAP_THRESHOLD + 8, 0, 0);
+    verify_size_with_large_blocks(base, 0);
+    validate_array(b, MMAP_THRESHOLD + 8);
+
+    sfree(b);
+    verify_blocks(0, 0, 0, 0);
+    verify_size_with_large_blocks(base, 0);
+}
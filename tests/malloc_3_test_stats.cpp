@@ -0,0 +1,95 @@
+#include "my_stdlib.h"
+#include <catch2/catch_test_macros.hpp>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+// smalloc_stats_print into a string
+static std::string stats(const char *format)
+{
+    char *buffer = nullptr;
+    size_t length = 0;
+    FILE *out = open_memstream(&buffer, &length);
+    REQUIRE(out != nullptr);
+    REQUIRE(smalloc_stats_print(out, format) == 0);
+    fclose(out);
+    std::string result(buffer, length);
+    free(buffer);
+    return result;
+}
+
+#define REQUIRE_STATS(format, text) REQUIRE(stats(format).find(text) != std::string::npos)
+
+TEST_CASE("Stats in JSON", "[stats]")
+{
+    char *a = (char *)smalloc(100);
+    char *b = (char *)smalloc(200 * 1024);
+    REQUIRE(a != nullptr);
+    REQUIRE(b != nullptr);
+
+    REQUIRE_STATS("json", "\"live_bytes\": 204904,");
+    REQUIRE_STATS("json", "\"heap\": {\"blocks\": 1, \"bytes\": 104, \"free_blocks\": 0, \"free_bytes\": 0,");
+    REQUIRE_STATS("json", "\"mmap\": {\"blocks\": 1, \"bytes\": 204800,");
+    // a block of 104 + metaData bytes, and a mapping
+    REQUIRE_STATS("json", "{\"min_size\": 128, \"max_size\": 255, \"allocs\": 1, \"frees\": 0, \"live_blocks\": 1, "
+                          "\"live_bytes\": 104, \"splits\": 0, \"merges\": 0}");
+    REQUIRE_STATS("json", "{\"min_size\": 131072, \"max_size\": 262143, \"allocs\": 1, \"frees\": 0, "
+                          "\"live_blocks\": 1, \"live_bytes\": 204800, \"splits\": 0, \"merges\": 0}");
+
+    sfree(b);
+    REQUIRE_STATS("json", "\"mmap\": {\"blocks\": 0, \"bytes\": 0,");
+    REQUIRE_STATS("json", "{\"min_size\": 131072, \"max_size\": 262143, \"allocs\": 1, \"frees\": 1, "
+                          "\"live_blocks\": 0, \"live_bytes\": 0, \"splits\": 0, \"merges\": 0}");
+    sfree(a);
+}
+
+TEST_CASE("Splits and merges are counted", "[stats]")
+{
+    char *a = (char *)smalloc(1000);
+    char *guard = (char *)smalloc(10);
+    REQUIRE(guard != nullptr);
+    sfree(a);
+
+    // a's block of 1040 bytes is split, and merged again
+    char *b = (char *)smalloc(100);
+    REQUIRE(b == a);
+    sfree(b);
+    REQUIRE_STATS("json", "{\"min_size\": 1024, \"max_size\": 2047, \"allocs\": 1, \"frees\": 1, \"live_blocks\": 0, "
+                          "\"live_bytes\": 0, \"splits\": 1, \"merges\": 1}");
+    REQUIRE_STATS("json", "{\"min_size\": 128, \"max_size\": 255, \"allocs\": 1, \"frees\": 1, \"live_blocks\": 0, "
+                          "\"live_bytes\": 0, \"splits\": 0, \"merges\": 0}");
+    sfree(guard);
+}
+
+TEST_CASE("srealloc and peak usage", "[stats]")
+{
+    char *a = (char *)smalloc(1000);
+    REQUIRE(a != nullptr);
+    // a free of the old block and an allocation of the new one
+    char *b = (char *)srealloc(a, 3000);
+    REQUIRE(b != nullptr);
+    REQUIRE_STATS("json", "{\"min_size\": 1024, \"max_size\": 2047, \"allocs\": 1, \"frees\": 1,");
+    REQUIRE_STATS("json", "{\"min_size\": 2048, \"max_size\": 4095, \"allocs\": 1, \"frees\": 0,");
+
+    sfree(b);
+    REQUIRE_STATS("json", "{\"id\": 0, \"live_bytes\": 0, \"peak_live_bytes\": 3000}");
+}
+
+TEST_CASE("Stats in text", "[stats]")
+{
+    char *a = (char *)smalloc(100);
+    REQUIRE(a != nullptr);
+    REQUIRE_STATS("text", "live bytes: 104\n");
+    REQUIRE_STATS("text", "arena 0: 104 live bytes, 104 peak live bytes\n");
+    REQUIRE_STATS("text", "syscalls: ");
+
+    FILE *out = fopen("/dev/null", "w");
+    REQUIRE(out != nullptr);
+    REQUIRE(smalloc_stats_print(out, "xml") == EINVAL);
+    REQUIRE(smalloc_stats_print(out, nullptr) == EINVAL);
+    REQUIRE(smalloc_stats_print(nullptr, "text") == EINVAL);
+    fclose(out);
+    sfree(a);
+}
@@ -0,0 +1,106 @@
+#include "my_stdlib.h"
+#include <catch2/catch_test_macros.hpp>
+
+#include <atomic>
+#include <thread>
+#include <unistd.h>
+
+#define TCACHE_COUNT (7)
+#define TCACHE_MAX_SIZE (1024)
+
+TEST_CASE("Freed blocks are cached", "[tcache]")
+{
+    char *a = (char *)smalloc(100);
+    REQUIRE(a != nullptr);
+    sfree(a);
+    // a cached block is still used as far as the heap is concerned
+    REQUIRE(_num_allocated_blocks() == 1);
+    REQUIRE(_num_free_blocks() == 0);
+
+    char *b = (char *)smalloc(97);
+    REQUIRE(b == a);
+    sfree(b);
+}
+
+TEST_CASE("Cache bins are bounded", "[tcache]")
+{
+    char *blocks[TCACHE_COUNT + 1];
+    for (int i = 0; i < TCACHE_COUNT + 1; i++)
+    {
+        blocks[i] = (char *)smalloc(100);
+        REQUIRE(blocks[i] != nullptr);
+    }
+    for (int i = 0; i < TCACHE_COUNT + 1; i++)
+    {
+        sfree(blocks[i]);
+    }
+    REQUIRE(_num_allocated_blocks() == TCACHE_COUNT + 1);
+    REQUIRE(_num_free_blocks() == 1);
+    REQUIRE(_num_free_bytes() == 104);
+
+    // cached blocks come back in LIFO order
+    REQUIRE(smalloc(100) == blocks[TCACHE_COUNT - 1]);
+}
+
+TEST_CASE("Large blocks are not cached", "[tcache]")
+{
+    char *a = (char *)smalloc(TCACHE_MAX_SIZE + 8);
+    REQUIRE(a != nullptr);
+    sfree(a);
+    REQUIRE(_num_free_blocks() == 1);
+    REQUIRE(_num_free_bytes() == TCACHE_MAX_SIZE + 8);
+}
+
+TEST_CASE("Thread exit flushes the cache", "[tcache]")
+{
+    // a block of this thread's arena, cached by the worker
+    char *a = (char *)smalloc(100);
+    REQUIRE(a != nullptr);
+    std::thread worker([a]() { sfree(a); });
+    worker.join();
+    REQUIRE(_num_allocated_blocks() == 1);
+    REQUIRE(_num_free_blocks() == 1);
+    REQUIRE(_num_free_bytes() == 104);
+
+    // the worker's exit gave it back to this thread's arena, and this thread's own cache is empty
+    REQUIRE(smalloc(100) == a);
+    REQUIRE(_num_free_blocks() == 0);
+}
+
+TEST_CASE("Threads allocate concurrently", "[tcache]")
+{
+    const int threads = 4;
+    const int rounds = 10000;
+    std::atomic<int> errors(0);
+    std::thread workers[threads];
+    for (int t = 0; t < threads; t++)
+    {
+        workers[t] = std::thread([t, &errors]() {
+            char *live[16] = {nullptr};
+            for (int i = 0; i < rounds; i++)
+            {
+                int slot = i % 16;
+                if (live[slot] && live[slot][0] != (char)t)
+                    errors++;
+                sfree(live[slot]);
+                live[slot] = (char *)smalloc(8 + (i * 7 + t) % 2000);
+                if (!live[slot])
+                    errors++;
+                else
+                    live[slot][0] = (char)t;
+            }
+            for (int slot = 0; slot < 16; slot++)
+            {
+                sfree(live[slot]);
+            }
+        });
+    }
+    for (int t = 0; t < threads; t++)
+    {
+        workers[t].join();
+    }
+    REQUIRE(errors == 0);
+    // every block was freed and every cache was flushed, so each arena merged back into at most one block
+    REQUIRE(_num_free_blocks() <= _num_arenas());
+    REQUIRE(_num_free_bytes() == _num_allocated_bytes());
+}
@@ -0,0 +1,109 @@
+#include "my_stdlib.h"
+#include <catch2/catch_test_macros.hpp>
+
+#include <unistd.h>
+
+// built with TRIM_THRESHOLD = TRIM_THRESHOLD_SIZE
+#define TRIM_THRESHOLD_SIZE (128 * 1024)
+#define PAGE_SIZE 4096
+
+#define verify_blocks(allocated_blocks, allocated_bytes, free_blocks, free_bytes)                                      \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        REQUIRE(_num_allocated_blocks() == (size_t)(allocated_blocks));                                                \
+        REQUIRE(_num_allocated_bytes() == (size_t)(allocated_bytes));                                                  \
+        REQUIRE(_num_free_blocks() == (size_t)(free_blocks));                                                          \
+        REQUIRE(_num_free_bytes() == (size_t)(free_bytes));                                                            \
+        REQUIRE(_num_meta_data_bytes() == _size_meta_data() * (allocated_blocks));                                     \
+    } while (0)
+
+#define verify_size(base)                                                                                              \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        void *after = sbrk(0);                                                                                         \
+        REQUIRE(_num_allocated_bytes() + _size_meta_data() * _num_allocated_blocks() ==                                \
+                (size_t)after - (size_t)base);                                                                         \
+    } while (0)
+
+TEST_CASE("Trim a large free wilderness", "[trim]")
+{
+    void *base = sbrk(0);
+    char *blocks[4];
+    for (int i = 0; i < 4; i++)
+    {
+        blocks[i] = (char *)smalloc(100 * 1024);
+        REQUIRE(blocks[i] != nullptr);
+    }
+    REQUIRE((size_t)sbrk(0) - (size_t)base > 400 * 1024);
+    verify_size(base);
+
+    // the wilderness alone is below the threshold
+    sfree(blocks[3]);
+    REQUIRE((size_t)sbrk(0) - (size_t)base > 400 * 1024);
+    verify_size(base);
+
+    sfree(blocks[2]);
+    REQUIRE((size_t)sbrk(0) - (size_t)base < 2 * 100 * 1024 + 2 * _size_meta_data() + PAGE_SIZE);
+    verify_size(base);
+    REQUIRE(_num_allocated_blocks() == 3);
+    REQUIRE(_num_free_blocks() == 1);
+    REQUIRE(_num_free_bytes() < PAGE_SIZE);
+
+    sfree(blocks[0]);
+    sfree(blocks[1]);
+    REQUIRE((size_t)sbrk(0) - (size_t)base <= PAGE_SIZE);
+    verify_size(base);
+    verify_blocks(1, _num_free_bytes(), 1, _num_free_bytes());
+
+    // and the heap grows again
+    char *a = (char *)smalloc(100 * 1024);
+    REQUIRE(a != nullptr);
+    verify_blocks(1, 100 * 1024, 0, 0);
+    verify_size(base);
+    sfree(a);
+}
+
+TEST_CASE("Free blocks below the wilderness are not trimmed", "[trim]")
+{
+    void *base = sbrk(0);
+    char *a = (char *)smalloc(120 * 1024);
+    char *b = (char *)smalloc(120 * 1024);
+    char *c = (char *)smalloc(10);
+    REQUIRE(c != nullptr);
+    sfree(a);
+    sfree(b);
+    // a and b merged, but c is the wilderness
+    verify_blocks(2, 240 * 1024 + _size_meta_data() + 16, 1, 240 * 1024 + _size_meta_data());
+    verify_size(base);
+    REQUIRE(strim(0) == 0);
+    sfree(c);
+}
+
+TEST_CASE("strim", "[trim]")
+{
+    void *base = sbrk(0);
+    char *a = (char *)smalloc(100 * 1024);
+    REQUIRE(a != nullptr);
+    REQUIRE(strim(0) == 0); // the wilderness is used
+
+    sfree(a);
+    verify_blocks(1, 100 * 1024, 1, 100 * 1024);
+
+    // keep 50KB
+    REQUIRE(strim(50 * 1024) == 1);
+    REQUIRE(_num_free_bytes() >= 50 * 1024);
+    REQUIRE(_num_free_bytes() < 50 * 1024 + PAGE_SIZE);
+    verify_size(base);
+
+    REQUIRE(strim(0) == 1);
+    REQUIRE(_num_free_bytes() < PAGE_SIZE);
+    verify_blocks(1, _num_free_bytes(), 1, _num_free_bytes());
+    verify_size(base);
+    REQUIRE(strim(0) == 0);
+
+    char *b = (char *)smalloc(40 * 1024);
+    REQUIRE(b != nullptr);
+    verify_blocks(1, 40 * 1024, 0, 0);
+    verify_size(base);
+    sfree(b);
+}
@@ -240,3 +240,19 @@ TEST_CASE("Dynamic mmap threshold max", "[malloc4]")
     verify_blocks(1, DEFAULT_MMAP_THRESHOLD_MAX - 8, 1, DEFAULT_MMAP_THRESHOLD_MAX - 8);
     verify_size(base);
 }
+
+TEST_CASE("Dynamic mmap threshold stats", "[malloc4]")
+{
+    REQUIRE(_mmap_threshold() == MMAP_THRESHOLD);
+    char *a = (char *)smalloc(2 * MMAP_THRESHOLD);
+    REQUIRE(a != nullptr);
+    REQUIRE(_mmap_threshold() == MMAP_THRESHOLD);
+    sfree(a);
+    REQUIRE(_mmap_threshold() == 2 * MMAP_THRESHOLD + _size_meta_data());
+
+    // blocks past the max are still mmapped, and don't raise it
+    char *b = (char *)smalloc(DEFAULT_MMAP_THRESHOLD_MAX + 8);
+    REQUIRE(b != nullptr);
+    sfree(b);
+    REQUIRE(_mmap_threshold() == 2 * MMAP_THRESHOLD + _size_meta_data());
+}
@@ -0,0 +1,145 @@
+#include "my_stdlib.h"
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <unistd.h>
+
+#define MAX_ALLOCATION_SIZE (1e8)
+#define MIN_BLOCK_SIZE (128)
+#define MAX_ORDER (10)
+#define MAX_BLOCK_SIZE (MIN_BLOCK_SIZE << MAX_ORDER)
+
+#define verify_blocks(allocated_blocks, allocated_bytes, free_blocks, free_bytes)                                      \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        REQUIRE(_num_allocated_blocks() == (size_t)(allocated_blocks));                                                \
+        REQUIRE(_num_allocated_bytes() == (size_t)(allocated_bytes));                                                  \
+        REQUIRE(_num_free_blocks() == (size_t)(free_blocks));                                                          \
+        REQUIRE(_num_free_bytes() == (size_t)(free_bytes));                                                            \
+        REQUIRE(_num_meta_data_bytes() == _size_meta_data() * (allocated_blocks));                                     \
+    } while (0)
+
+TEST_CASE("Sanity", "[buddy]")
+{
+    verify_blocks(0, 0, 0, 0);
+    char *a = (char *)smalloc(10);
+    REQUIRE(a != nullptr);
+    // one MAX_ORDER block split down to order 0: a used block and a free buddy for each order
+    verify_blocks(MAX_ORDER + 1, MAX_BLOCK_SIZE - (MAX_ORDER + 1) * _size_meta_data(), MAX_ORDER,
+                  MAX_BLOCK_SIZE - MIN_BLOCK_SIZE - MAX_ORDER * _size_meta_data());
+    REQUIRE((uintptr_t)(a - _size_meta_data()) % MAX_BLOCK_SIZE == 0);
+
+    sfree(a);
+    verify_blocks(1, MAX_BLOCK_SIZE - _size_meta_data(), 1, MAX_BLOCK_SIZE - _size_meta_data());
+}
+
+TEST_CASE("0 size and max size", "[buddy]")
+{
+    void *base = sbrk(0);
+    REQUIRE(smalloc(0) == nullptr);
+    REQUIRE(smalloc(MAX_ALLOCATION_SIZE + 1) == nullptr);
+    // the product wraps around to 2 bytes
+    REQUIRE(scalloc(SIZE_MAX / 2 + 2, 2) == nullptr);
+    REQUIRE(sbrk(0) == base);
+    verify_blocks(0, 0, 0, 0);
+}
+
+TEST_CASE("Buddies", "[buddy]")
+{
+    char *a = (char *)smalloc(MIN_BLOCK_SIZE - _size_meta_data());
+    char *b = (char *)smalloc(MIN_BLOCK_SIZE - _size_meta_data());
+    REQUIRE(a != nullptr);
+    REQUIRE(b != nullptr);
+    REQUIRE(((uintptr_t)a ^ (uintptr_t)b) == MIN_BLOCK_SIZE);
+    verify_blocks(MAX_ORDER + 1, MAX_BLOCK_SIZE - (MAX_ORDER + 1) * _size_meta_data(), MAX_ORDER - 1,
+                  MAX_BLOCK_SIZE - 2 * MIN_BLOCK_SIZE - (MAX_ORDER - 1) * _size_meta_data());
+
+    // a's buddy is used, nothing to merge with
+    sfree(a);
+    verify_blocks(MAX_ORDER + 1, MAX_BLOCK_SIZE - (MAX_ORDER + 1) * _size_meta_data(), MAX_ORDER,
+                  MAX_BLOCK_SIZE - MIN_BLOCK_SIZE - MAX_ORDER * _size_meta_data());
+
+    // b merges all the way up
+    sfree(b);
+    verify_blocks(1, MAX_BLOCK_SIZE - _size_meta_data(), 1, MAX_BLOCK_SIZE - _size_meta_data());
+
+    // the freed order 0 block is reused
+    char *c = (char *)smalloc(10);
+    REQUIRE(c == a);
+    sfree(c);
+}
+
+TEST_CASE("Heap grows by whole blocks", "[buddy]")
+{
+    size_t half = MAX_BLOCK_SIZE / 2 - _size_meta_data();
+    char *a = (char *)smalloc(half);
+    char *b = (char *)smalloc(half);
+    REQUIRE(a != nullptr);
+    REQUIRE(b != nullptr);
+    verify_blocks(2, 2 * half, 0, 0);
+
+    char *c = (char *)smalloc(half);
+    REQUIRE(c != nullptr);
+    verify_blocks(4, 4 * half, 1, half);
+
+    sfree(a);
+    sfree(b);
+    sfree(c);
+    verify_blocks(2, 2 * (MAX_BLOCK_SIZE - _size_meta_data()), 2, 2 * (MAX_BLOCK_SIZE - _size_meta_data()));
+}
+
+TEST_CASE("Large allocation", "[buddy]")
+{
+    void *base = sbrk(0);
+    char *a = (char *)smalloc(MAX_BLOCK_SIZE);
+    REQUIRE(a != nullptr);
+    REQUIRE(sbrk(0) == base);
+    verify_blocks(1, MAX_BLOCK_SIZE, 0, 0);
+
+    sfree(a);
+    verify_blocks(0, 0, 0, 0);
+}
+
+TEST_CASE("srealloc merges with buddies", "[buddy]")
+{
+    char *a = (char *)smalloc(10);
+    REQUIRE(a != nullptr);
+    std::memset(a, 'a', 10);
+
+    char *b = (char *)srealloc(a, 4 * MIN_BLOCK_SIZE - _size_meta_data());
+    REQUIRE(b == a);
+    for (int i = 0; i < 10; i++)
+    {
+        REQUIRE(b[i] == 'a');
+    }
+    verify_blocks(MAX_ORDER - 1, MAX_BLOCK_SIZE - (MAX_ORDER - 1) * _size_meta_data(), MAX_ORDER - 2,
+                  MAX_BLOCK_SIZE - 4 * MIN_BLOCK_SIZE - (MAX_ORDER - 2) * _size_meta_data());
+
+    // smaller than the block- stays in place
+    REQUIRE(srealloc(b, 10) == b);
+
+    sfree(b);
+    verify_blocks(1, MAX_BLOCK_SIZE - _size_meta_data(), 1, MAX_BLOCK_SIZE - _size_meta_data());
+}
+
+TEST_CASE("srealloc moves when buddy is used", "[buddy]")
+{
+    char *a = (char *)smalloc(10);
+    char *b = (char *)smalloc(10);
+    REQUIRE(a != nullptr);
+    REQUIRE(b != nullptr);
+    std::memset(a, 'a', 10);
+
+    char *c = (char *)srealloc(a, 2 * MIN_BLOCK_SIZE - _size_meta_data());
+    REQUIRE(c != nullptr);
+    REQUIRE(c != a);
+    for (int i = 0; i < 10; i++)
+    {
+        REQUIRE(c[i] == 'a');
+    }
+
+    sfree(b);
+    sfree(c);
+    verify_blocks(1, MAX_BLOCK_SIZE - _size_meta_data(), 1, MAX_BLOCK_SIZE - _size_meta_data());
+}
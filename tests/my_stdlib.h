@@ -2,11 +2,22 @@
 #define MY_STDLIB_H
 
 #include <stddef.h>
+#include <stdio.h>
 
 void *smalloc(size_t size);
 void *scalloc(size_t num, size_t size);
 void sfree(void *p);
+void sfree_sized(void *p, size_t size);
 void *srealloc(void *oldp, size_t size);
+size_t smalloc_batch(size_t size, size_t count, void **out_ptrs);
+void sfree_batch(void **ptrs, size_t count);
+void *smemalign(size_t alignment, size_t size);
+void *saligned_alloc(size_t alignment, size_t size);
+int sposix_memalign(void **memptr, size_t alignment, size_t size);
+int strim(size_t pad);
+int spurge();
+void sset_purge_decay(size_t decay_ms);
+int smalloc_stats_print(FILE *out, const char *format);
 
 size_t _num_free_blocks();
 size_t _num_free_bytes();
@@ -14,5 +25,23 @@ size_t _num_allocated_blocks();
 size_t _num_allocated_bytes();
 size_t _num_meta_data_bytes();
 size_t _size_meta_data();
+size_t _num_arenas();
+size_t _mmap_threshold();
+size_t _num_purged_bytes();
+size_t _num_dirty_bytes();
+size_t _num_muzzy_bytes();
+size_t _num_mmap_cache_hits();
+size_t _num_mmap_cache_misses();
+size_t _num_mmap_cached_bytes();
+size_t _num_heap_segments();
+size_t _num_sbrk_calls();
+size_t _num_mmap_calls();
+size_t _num_munmap_calls();
+size_t _num_resident_bytes();
+
+// slab layer (malloc_3 built with USE_SLABS)
+size_t _num_slabs();
+size_t _num_slab_objects();
+size_t _num_slab_bytes();
 
 #endif /* MY_STDLIB_H */